@@ -0,0 +1,279 @@
+// The size of the slabs that an arena carves small blocks from.
+const size_t arena_slab_size = 1 << 20;
+
+// The size of the smallest block of an arena. Block sizes are powers of two,
+// starting at this size.
+const size_t arena_min_block = 16;
+
+// The amount of block sizes that are carved from slabs (16 bytes up to 64
+// KB). Bigger blocks are allocated from the system one by one.
+const int arena_classes = 13;
+
+// A slab allocator. Small blocks are carved from big slabs and recycled
+// through a free list per block size, so allocating and freeing a block
+// almost never calls into the system allocator. Freeing a block requires its
+// size, so blocks carry no header. All blocks can be released at once, which
+// is how the rows of a document are freed when it is closed.
+class arena {
+private:
+	// A block on a free list.
+	struct free_block {
+		free_block* next;
+	};
+
+	// The header of a block that is too big to be carved from a slab. These
+	// blocks are kept in a list, so that they can be released at once.
+	struct alignas(16) large_block {
+		large_block* prev;
+		large_block* next;
+	};
+
+	// The slabs, and the unused remainder of the last slab.
+	std::vector<char*> slabs;
+	char* cursor = NULL;
+	size_t remaining = 0;
+
+	// The free lists (one per block size).
+	free_block* free_lists[arena_classes] = {};
+
+	// The blocks that are too big to be carved from a slab.
+	large_block* large = NULL;
+
+	// The slot that refers to this arena.
+	arena** slot;
+
+	// Get the block size class of an allocation size.
+	static int size_class(size_t size) {
+		int index = 0;
+		while ((arena_min_block << index) < size) {
+			index++;
+		}
+		return index;
+	}
+
+public:
+	// The amount of blocks that have been allocated, the amount of them that
+	// are still in use, and the amount of times the system allocator has
+	// been called.
+	size_t allocations = 0;
+	size_t live = 0;
+	size_t system_allocations = 0;
+
+	// Create an arena, and make the specified slot refer to it until it is
+	// destroyed. A slot has one arena at a time, since the blocks allocated
+	// through it have to be freed to the arena they came from.
+	arena(arena*& slot) {
+		if (slot) {
+			barf("Only one arena can use a slot at a time.");
+		}
+		this->slot = &slot;
+		slot = this;
+	}
+
+	// Destructor.
+	~arena() {
+		release();
+		*slot = NULL;
+	}
+
+	// Disallow copying.
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	// Get the size of the block that an allocation of the specified size
+	// gets. Callers can use all of it.
+	static size_t block_size(size_t size) {
+		if (size > (arena_min_block << (arena_classes - 1))) {
+			return size;
+		}
+		return arena_min_block << size_class(size);
+	}
+
+	// Allocate a block of at least the specified size (aligned to 16 bytes).
+	void* allocate(size_t size) {
+		allocations++;
+		live++;
+		if (size > (arena_min_block << (arena_classes - 1))) {
+			// Allocate a big block from the system.
+			system_allocations++;
+			large_block* block = (large_block*)malloc(
+				sizeof(large_block) + size
+			);
+			if (!block) {
+				barf("Could not allocate arena memory.");
+			}
+			block->prev = NULL;
+			block->next = large;
+			if (large) {
+				large->prev = block;
+			}
+			large = block;
+			return block + 1;
+		}
+		int index = size_class(size);
+		if (free_lists[index]) {
+			// Reuse a freed block.
+			free_block* block = free_lists[index];
+			free_lists[index] = block->next;
+			return block;
+		}
+		size = arena_min_block << index;
+		if (remaining < size) {
+			// Put the remainder of the last slab on the free lists, and start
+			// a new slab.
+			for (int i = arena_classes - 1; i >= 0; i--) {
+				while (remaining >= (arena_min_block << i)) {
+					free_block* block = (free_block*)cursor;
+					block->next = free_lists[i];
+					free_lists[i] = block;
+					cursor += arena_min_block << i;
+					remaining -= arena_min_block << i;
+				}
+			}
+			system_allocations++;
+			cursor = (char*)malloc(arena_slab_size);
+			if (!cursor) {
+				barf("Could not allocate arena memory.");
+			}
+			slabs.push_back(cursor);
+			remaining = arena_slab_size;
+		}
+		void* block = cursor;
+		cursor += size;
+		remaining -= size;
+		return block;
+	}
+
+	// Free a block. The size must be the size it was allocated with.
+	void deallocate(void* pointer, size_t size) {
+		live--;
+		if (size > (arena_min_block << (arena_classes - 1))) {
+			large_block* block = (large_block*)pointer - 1;
+			if (block->prev) {
+				block->prev->next = block->next;
+			} else {
+				large = block->next;
+			}
+			if (block->next) {
+				block->next->prev = block->prev;
+			}
+			free(block);
+			return;
+		}
+		int index = size_class(size);
+		free_block* block = (free_block*)pointer;
+		block->next = free_lists[index];
+		free_lists[index] = block;
+	}
+
+	// Allocate and construct an object.
+	template <class T, class... A>
+	T* create(A&&... arguments) {
+		return new (allocate(sizeof(T))) T(std::forward<A>(arguments)...);
+	}
+
+	// Destruct and free an object that was created by create().
+	template <class T>
+	void destroy(T* object) {
+		if (object) {
+			object->~T();
+			deallocate(object, sizeof(T));
+		}
+	}
+
+	// Free all blocks at once. Objects that were allocated from this arena
+	// are not destructed, so nothing may refer to them anymore.
+	void release() {
+		for (size_t i = 0; i < slabs.size(); i++) {
+			free(slabs[i]);
+		}
+		slabs.clear();
+		cursor = NULL;
+		remaining = 0;
+		for (int i = 0; i < arena_classes; i++) {
+			free_lists[i] = NULL;
+		}
+		while (large) {
+			large_block* next = large->next;
+			free(large);
+			large = next;
+		}
+		live = 0;
+	}
+};
+
+// An allocator for standard containers that allocates from the arena that a
+// slot refers to.
+template <class T, arena** slot>
+struct arena_allocator {
+	typedef T value_type;
+
+	// Default constructor.
+	arena_allocator() {}
+
+	// Conversion from an allocator of another type.
+	template <class U>
+	arena_allocator(const arena_allocator<U, slot>&) {}
+
+	// Allocate storage for an amount of objects.
+	T* allocate(size_t count) {
+		return (T*)(*slot)->allocate(count * sizeof(T));
+	}
+
+	// Free storage for an amount of objects.
+	void deallocate(T* pointer, size_t count) {
+		(*slot)->deallocate(pointer, count * sizeof(T));
+	}
+
+	// Rebind this allocator to another type.
+	template <class U>
+	struct rebind {
+		typedef arena_allocator<U, slot> other;
+	};
+};
+
+// All allocators for the same slot are interchangeable.
+template <class T, class U, arena** slot>
+bool operator==(const arena_allocator<T, slot>&,
+				const arena_allocator<U, slot>&)
+{
+	return true;
+}
+template <class T, class U, arena** slot>
+bool operator!=(const arena_allocator<T, slot>&,
+				const arena_allocator<U, slot>&)
+{
+	return false;
+}
+
+// The arena that rows, their color spans, and the pieces of documents are
+// allocated from. The editor owns it, so only one editor can exist at a time.
+arena* row_storage = NULL;
+
+#ifdef ALLOCATION_STATS
+// The amount of blocks that the current thread has allocated from the heap
+// (with operator new), which the allocation report uses to check that hot
+// paths like highlighting do not allocate.
+thread_local size_t heap_allocations = 0;
+
+// Allocate a block from the heap, and count it.
+void* operator new(size_t size) {
+	heap_allocations++;
+	void* block = malloc(size ? size : 1);
+	if (!block) {
+		throw std::bad_alloc();
+	}
+	return block;
+}
+
+// Free a block that was allocated from the heap. It is not inlined, so that
+// compilers do not mistake the block for one that malloc() returned.
+#ifdef _MSC_VER
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void operator delete(void* block) noexcept {
+	free(block);
+}
+#endif
\ No newline at end of file
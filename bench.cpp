@@ -0,0 +1,366 @@
+/*
+ * BOSS highlighting benchmark
+ *
+ * Compile and run with
+ *     ./bench.sh [--edits <count>] [--seed <seed>] <file>...
+ *
+ * Highlights a corpus of files without opening a window, and prints the
+ * results as JSON. For every file, the lexer of its syntax highlighting mode
+ * (C++ if its extension is unknown) is run over every line, and then every
+ * row is highlighted through the editor in order. Optionally, single
+ * character edits are made at random positions (every other edit erases the
+ * character the edit before it typed) and the rows in view are highlighted
+ * after each one.
+ */
+
+#define ALLOCATION_STATS
+#define BOSS_NO_MAIN
+#include "boss.cpp"
+
+// Count the tokens of a line with the syntax highlighting rules of a
+// language, starting from a lexer state. The state is set to the state at the
+// end of the line.
+template <class L>
+size_t count_tokens(const char* text, size_t length, int& state) {
+	lexer<L> lexer(text, length, state, false);
+	token token;
+	size_t tokens = 0;
+	while (lexer.next(token)) {
+		tokens++;
+	}
+	if (length > 0) {
+		state = lexer.state() & ls_open;
+	}
+	return tokens;
+}
+
+// A function that counts the tokens of a line.
+typedef size_t (*token_counter)(const char* text, size_t length, int& state);
+
+// The token counter of every syntax highlighting mode.
+const token_counter token_counters[] = {
+	NULL,
+	count_tokens<c_rules>,
+	count_tokens<cpp_rules>
+};
+static_assert(
+	sizeof(token_counters) / sizeof(token_counters[0]) ==
+	sizeof(syntax_engines) / sizeof(syntax_engines[0]),
+	"Every syntax highlighting mode needs a token counter."
+);
+
+// The characters that the edits type.
+const char edit_characters[] = "abcxyz019 _;,.(){}[]+-*/=<>\"'#";
+
+// Get the time since an earlier performance counter value, in microseconds.
+double microseconds_since(Uint64 start) {
+	return double(
+		SDL_GetPerformanceCounter() - start
+	) / double(SDL_GetPerformanceFrequency()) * 1e6;
+}
+
+// Get a percentile of a list of latencies. The list is reordered.
+double percentile(std::vector<double>& latencies, double fraction) {
+	if (latencies.empty()) {
+		return 0.0;
+	}
+	size_t index = size_t(fraction * (latencies.size() - 1) + 0.5);
+	std::nth_element(
+		latencies.begin(),
+		latencies.begin() + index,
+		latencies.end()
+	);
+	return latencies[index];
+}
+
+// Quote a string as a JSON string.
+std::string json_string(const std::string& text) {
+	std::stringstream out;
+	out << '"';
+	for (size_t i = 0; i < text.size(); i++) {
+		unsigned char c = text[i];
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (c < 0x20) {
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0');
+			out << int(c) << std::dec;
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+	return out.str();
+}
+
+// The results of benchmarking a file.
+struct bench_result {
+	std::string filename;
+	highlight_mode mode = hm_null;
+	size_t bytes = 0;
+	size_t lines = 0;
+
+	// The lexer pass.
+	size_t tokens = 0;
+	double lex_seconds = 0.0;
+
+	// The highlighting pass, with the latency of every row.
+	size_t rows = 0;
+	size_t allocations = 0;
+	size_t highlight_allocations = 0;
+	double highlight_seconds = 0.0;
+	std::vector<double> row_latencies;
+
+	// The edits, with the latency of highlighting after every edit.
+	size_t edits = 0;
+	size_t edit_rows = 0;
+	size_t edit_allocations = 0;
+	std::vector<double> edit_latencies;
+};
+
+// Run the lexer of a syntax highlighting mode over every line of a file.
+bool bench_lexer(bench_result& result) {
+	std::ifstream file(result.filename, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::string text = contents.str();
+	result.bytes = text.size();
+
+	token_counter count = token_counters[result.mode];
+	Uint64 start = SDL_GetPerformanceCounter();
+	int state = 0;
+	size_t offset = 0;
+	while (offset < text.size()) {
+		const char* line = text.data() + offset;
+		const char* newline = (const char*)memchr(
+			line,
+			'\n',
+			text.size() - offset
+		);
+		size_t length = newline ? newline - line : text.size() - offset;
+		result.tokens += count(line, length, state);
+		result.lines++;
+		offset += length + 1;
+	}
+	result.lex_seconds = microseconds_since(start) / 1e6;
+	return true;
+}
+
+// Highlight every row of a file in order through an editor. A long row is
+// highlighted until all of its chunks are.
+void bench_highlight(editor& boss, bench_result& result) {
+	boss.doc.reach(-1);
+	boss.scroll_y = 0;
+	size_t heap_before = heap_allocations;
+	size_t arena_before = boss.storage.allocations;
+	size_t lexed_before = boss.lexed_heap_allocations +
+						  boss.lexed_arena_allocations;
+	Uint64 start = SDL_GetPerformanceCounter();
+	while (boss.highlighted < boss.doc.size()) {
+		Uint64 row_start = SDL_GetPerformanceCounter();
+		while (!boss.update(boss.highlighted)) {
+			continue;
+		}
+		result.row_latencies.push_back(microseconds_since(row_start));
+		boss.highlighted++;
+	}
+	result.highlight_seconds = microseconds_since(start) / 1e6;
+	result.rows = boss.doc.size();
+	result.allocations = heap_allocations - heap_before +
+						 boss.storage.allocations - arena_before;
+	result.highlight_allocations = boss.lexed_heap_allocations +
+								   boss.lexed_arena_allocations -
+								   lexed_before;
+}
+
+// Make single character edits at random positions of a file, and highlight
+// the rows in view after each of them. Every other edit erases the
+// character that the edit before it typed.
+void bench_edits(editor& boss, bench_result& result, int edits) {
+	for (int i = 0; i < edits && boss.doc.size() > 0; i++) {
+		SDL_Event e;
+		memset(&e, 0, sizeof(e));
+		if (i % 2 == 0) {
+			// Type a character at a random position, in the middle of the
+			// view.
+			boss.cursor_y = rand() % boss.doc.size();
+			boss.cursor_x = rand() % (boss.doc.line(boss.cursor_y).size() + 1);
+			boss.scroll_y = std::max(
+				boss.cursor_y - boss.vga_text_mode_y_res / 2,
+				0
+			);
+			e.type = SDL_TEXTINPUT;
+			e.text.text[0] = edit_characters[
+				rand() % (sizeof(edit_characters) - 1)
+			];
+		} else {
+			// Erase the character.
+			e.type = SDL_KEYDOWN;
+			e.key.keysym.sym = SDLK_BACKSPACE;
+		}
+		boss.key(e);
+
+		// Highlight the rows in view again.
+		size_t rows_before = boss.lexed_rows;
+		size_t heap_before = heap_allocations;
+		size_t arena_before = boss.storage.allocations;
+		Uint64 start = SDL_GetPerformanceCounter();
+		boss.highlight_view();
+		result.edit_latencies.push_back(microseconds_since(start));
+		result.edit_rows += boss.lexed_rows - rows_before;
+		result.edit_allocations += heap_allocations - heap_before +
+								   boss.storage.allocations - arena_before;
+		result.edits++;
+	}
+}
+
+// Print the results of a file as a JSON object.
+void print_result(bench_result& result) {
+	double megabytes = result.bytes / double(1 << 20);
+	double rows = std::max(result.rows, size_t(1));
+	std::cout << "\t\t{" << std::endl;
+	std::cout << "\t\t\t\"file\": " << json_string(result.filename);
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\"mode\": ";
+	std::cout << json_string(highlight_mode_string[result.mode]);
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\"bytes\": " << result.bytes << "," << std::endl;
+	std::cout << "\t\t\t\"lines\": " << result.lines << "," << std::endl;
+	std::cout << "\t\t\t\"lexer\": {" << std::endl;
+	std::cout << "\t\t\t\t\"seconds\": " << result.lex_seconds;
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\t\"mb_per_s\": ";
+	std::cout << megabytes / std::max(result.lex_seconds, 1e-9);
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\t\"tokens\": " << result.tokens << "," << std::endl;
+	std::cout << "\t\t\t\t\"tokens_per_s\": ";
+	std::cout << result.tokens / std::max(result.lex_seconds, 1e-9);
+	std::cout << std::endl;
+	std::cout << "\t\t\t}," << std::endl;
+	std::cout << "\t\t\t\"highlight\": {" << std::endl;
+	std::cout << "\t\t\t\t\"rows\": " << result.rows << "," << std::endl;
+	std::cout << "\t\t\t\t\"seconds\": " << result.highlight_seconds;
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\t\"mb_per_s\": ";
+	std::cout << megabytes / std::max(result.highlight_seconds, 1e-9);
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\t\"allocations_per_line\": ";
+	std::cout << result.allocations / rows << "," << std::endl;
+	std::cout << "\t\t\t\t\"lexer_allocations_per_line\": ";
+	std::cout << result.highlight_allocations / rows << "," << std::endl;
+	std::cout << "\t\t\t\t\"p50_us\": ";
+	std::cout << percentile(result.row_latencies, 0.5) << "," << std::endl;
+	std::cout << "\t\t\t\t\"p99_us\": ";
+	std::cout << percentile(result.row_latencies, 0.99) << std::endl;
+	std::cout << "\t\t\t}," << std::endl;
+	std::cout << "\t\t\t\"edits\": {" << std::endl;
+	std::cout << "\t\t\t\t\"count\": " << result.edits << "," << std::endl;
+	std::cout << "\t\t\t\t\"rows_per_edit\": ";
+	std::cout << result.edit_rows / std::max(double(result.edits), 1.0);
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\t\"allocations_per_edit\": ";
+	std::cout << result.edit_allocations / std::max(double(result.edits), 1.0);
+	std::cout << "," << std::endl;
+	std::cout << "\t\t\t\t\"p50_us\": ";
+	std::cout << percentile(result.edit_latencies, 0.5) << "," << std::endl;
+	std::cout << "\t\t\t\t\"p99_us\": ";
+	std::cout << percentile(result.edit_latencies, 0.99) << std::endl;
+	std::cout << "\t\t\t}" << std::endl;
+	std::cout << "\t\t}";
+}
+
+// Entry point.
+int main(int argc, char** argv) {
+	// Print the credits (for reference purposes). The results are printed to
+	// the standard output, and everything else to the standard error.
+	std::cerr << credits << std::endl;
+
+	// Parse command line arguments.
+	int edits = 0;
+	unsigned int seed = 1;
+	std::vector<std::string> corpus;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--edits" && i + 1 < argc) {
+			edits = atoi(argv[++i]);
+		} else if (argument == "--seed" && i + 1 < argc) {
+			seed = atoi(argv[++i]);
+		} else {
+			corpus.push_back(argument);
+		}
+	}
+	if (corpus.empty()) {
+		std::cerr << "Usage: " << argv[0];
+		std::cerr << " [--edits <count>] [--seed <seed>] <file>...";
+		std::cerr << std::endl;
+		exit(-1);
+	}
+	srand(seed);
+
+	// Create an editor. It is never shown, and it does not report the
+	// allocations of every edit; they are reported once at the end.
+	editor boss(120, 50);
+	boss.report_edits = false;
+
+	// Benchmark every file of the corpus.
+	std::vector<bench_result> results;
+	for (size_t i = 0; i < corpus.size(); i++) {
+		bench_result result;
+		result.filename = corpus[i];
+		result.mode = find_highlight_mode(result.filename);
+		if (result.mode == hm_null) {
+			result.mode = hm_cpp;
+		}
+		if (!bench_lexer(result) || !boss.open(corpus[i].c_str())) {
+			std::cerr << "Could not open " << corpus[i] << std::endl;
+			continue;
+		}
+		boss.highlight = result.mode;
+		bench_highlight(boss, result);
+		bench_edits(boss, result, edits);
+		results.push_back(result);
+	}
+
+	// Report the allocations of the whole run.
+	boss.report("Bench");
+
+	// Print the results, and the totals of the corpus.
+	bench_result total;
+	total.filename = "total";
+	total.mode = hm_null;
+	std::cout << "{" << std::endl;
+	std::cout << "\t\"files\": [" << std::endl;
+	for (size_t i = 0; i < results.size(); i++) {
+		bench_result& result = results[i];
+		total.bytes += result.bytes;
+		total.lines += result.lines;
+		total.tokens += result.tokens;
+		total.lex_seconds += result.lex_seconds;
+		total.rows += result.rows;
+		total.allocations += result.allocations;
+		total.highlight_allocations += result.highlight_allocations;
+		total.highlight_seconds += result.highlight_seconds;
+		total.row_latencies.insert(
+			total.row_latencies.end(),
+			result.row_latencies.begin(),
+			result.row_latencies.end()
+		);
+		total.edits += result.edits;
+		total.edit_rows += result.edit_rows;
+		total.edit_allocations += result.edit_allocations;
+		total.edit_latencies.insert(
+			total.edit_latencies.end(),
+			result.edit_latencies.begin(),
+			result.edit_latencies.end()
+		);
+		print_result(result);
+		std::cout << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	std::cout << "\t]," << std::endl;
+	std::cout << "\t\"total\":" << std::endl;
+	print_result(total);
+	std::cout << std::endl << "}" << std::endl;
+	return 0;
+}
\ No newline at end of file
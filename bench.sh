@@ -0,0 +1 @@
+c++ bench.cpp -o bench.o -O2 -std=c++11 -pthread `sdl2-config --cflags` `sdl2-config --libs` -Wall -Wextra -Wno-sign-compare && ./bench.o "$@"
\ No newline at end of file
@@ -10,13 +10,40 @@
  */
 
 #include <ctime>
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
 #include <memory>
+#include <new>
+#include <thread>
 #include <vector>
 #include <string>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <condition_variable>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include <SDL.h>
 
@@ -30,12 +57,23 @@
 #include "video.hpp"
 #include "font.hpp"
 #include "vga.hpp"
+#include "arena.hpp"
 #include "row.hpp"
+#include "scan.hpp"
+#include "document.hpp"
+#include "save.hpp"
+#include "journal.hpp"
+#include "regex.hpp"
+#include "search.hpp"
+#include "keywords.hpp"
 
 #include "syntax.hpp"
+#include "highlighter.hpp"
 #include "editor.hpp"
 
-// Rasterize the text buffer to the video buffer of a video_interface*.
+// Rasterize the text buffer to the video buffer of a video_interface*. Only
+// the cells that changed since they were last rasterized are rasterized, and
+// the changed parts of the video buffer are marked for the video card.
 void editor::raster(video_interface* vga) {
 	// Calculate the glyph size (in bits).
 	int glyph_size = (
@@ -43,45 +81,87 @@ void editor::raster(video_interface* vga) {
 		vga_001_y_res
 	);
 	
-	for (int i = 0; i < vga_text_mode_x_res; i++)
 	for (int j = 0; j < vga_text_mode_y_res; j++) {
-		// Unpack the current glyph.
-		glyph glyph = text[
-			j * vga_text_mode_x_res + i
-		];
-		
-		// Fetch the VGA colors.
-		Uint32 u32_fg = vga_argb8888[glyph.fg];
-		Uint32 u32_bg = vga_argb8888[glyph.bg];
-		
-		// Fetch the ASCII code.
-		unsigned char ascii = glyph.ascii;
-
-		// Fetch the glyph font pointer.
-		unsigned char* font = vga_001 + glyph_size * ascii;
-
-		// Rasterize the glyph.
-		for (int x = 0; x < vga_001_x_res; x++)
-		for (int y = 0; y < vga_001_y_res; y++) {
-			if (font[y * vga_001_x_res + x]) {
-				vga->set(
-					i * vga_001_x_res + x,
-					j * vga_001_y_res + y,
-					u32_fg
-				);
-			} else {
-				vga->set(
-					i * vga_001_x_res + x,
-					j * vga_001_y_res + y,
-					u32_bg
-				);
+		// The first and last changed cell of the row.
+		int first = -1;
+		int last = -1;
+
+		for (int i = 0; i < vga_text_mode_x_res; i++) {
+			// Skip the current glyph if it has been rasterized already.
+			glyph& old = shown[
+				j * vga_text_mode_x_res + i
+			];
+
+			// Unpack the current glyph.
+			glyph glyph = text[
+				j * vga_text_mode_x_res + i
+			];
+
+			if (glyph.ascii == old.ascii &&
+				glyph.fg == old.fg &&
+				glyph.bg == old.bg)
+			{
+				continue;
 			}
+			old = glyph;
+			if (first < 0) {
+				first = i;
+			}
+			last = i;
+
+			// Fetch the VGA colors.
+			Uint32 u32_fg = vga_argb8888[glyph.fg];
+			Uint32 u32_bg = vga_argb8888[glyph.bg];
+
+			// Fetch the ASCII code.
+			unsigned char ascii = glyph.ascii;
+
+			// Fetch the glyph font pointer.
+			unsigned char* font = vga_001 + glyph_size * ascii;
+
+			// Rasterize the glyph.
+			for (int x = 0; x < vga_001_x_res; x++)
+			for (int y = 0; y < vga_001_y_res; y++) {
+				if (font[y * vga_001_x_res + x]) {
+					vga->set(
+						i * vga_001_x_res + x,
+						j * vga_001_y_res + y,
+						u32_fg
+					);
+				} else {
+					vga->set(
+						i * vga_001_x_res + x,
+						j * vga_001_y_res + y,
+						u32_bg
+					);
+				}
+			}
+		}
+
+		// Mark the changed cells of the row.
+		if (first >= 0) {
+			vga->touch(
+				first * vga_001_x_res,
+				j * vga_001_y_res,
+				(last - first + 1) * vga_001_x_res,
+				vga_001_y_res
+			);
 		}
 	}
 
-	// Draw Mario (8x16 mode only).
+	// Draw Mario (8x16 mode only). He is drawn over the cells of the top row,
+	// which are rasterized again next time to erase him.
 	int mario_x = (SDL_GetTicks() / 15) % (vga->x_res + 32) - 16;
 	if (vga_001_y_res == 16) {
+		int left = std::max(mario_x, 0) / vga_001_x_res;
+		int right = std::min(
+			(mario_x + 15) / vga_001_x_res,
+			vga_text_mode_x_res - 1
+		);
+		for (int i = left; i <= right; i++) {
+			forget(shown[i]);
+		}
+		vga->touch(mario_x, 0, 16, 16);
 		for (int x = 0; x < 16; x++) {
 			for (int y = 0; y < 16; y++) {
 				if (SDL_GetTicks() % 200 >= 100) {
@@ -104,110 +184,755 @@ void editor::raster(video_interface* vga) {
 	}
 }
 
-// Update a row.
-void editor::update(int row_index) {
+// Close the current document and open a file. The rows of the document and
+// of the undo history are freed at once by releasing the row arena.
+bool editor::open(const char* filename) {
+	search.cancel();
+	background.cancel();
+	history.clear();
+	doc.clear();
+	highlighted = 0;
+	dirty_begin = dirty_end = 0;
+	return doc.open(filename);
+}
+
+// Report the allocation counts of the row arena.
+void editor::report(const char* when) {
+	std::cerr << when << ": " << storage.allocations << " allocations, ";
+	std::cerr << storage.live << " in use, ";
+	std::cerr << storage.system_allocations << " from the system" << std::endl;
+	#ifdef ALLOCATION_STATS
+	std::cerr << when << ": " << lexed_rows << " rows highlighted, ";
+	std::cerr << lexed_heap_allocations << " heap allocations, ";
+	std::cerr << lexed_arena_allocations << " arena allocations" << std::endl;
+	#endif
+}
+
+// Find the lexer state at the start of a row. The state at the end of the row
+// above is used if that row has been highlighted: if it is one of the leading
+// highlighted rows, or if it is in view (the rows in view are highlighted in
+// order). The first row in view below the highlighted rows starts from the
+// state the background highlighter found for it, or else from the state it
+// was highlighted from before, until the background highlighter gets to it.
+int editor::upper_state(int row_index) {
+	if (row_index <= 0) {
+		return 0;
+	} else if (row_index <= highlighted || row_index > scroll_y) {
+		return doc.line(row_index - 1).open ? ls_open : 0;
+	}
+	int state;
+	if (background.state(row_index - 1, state)) {
+		return state;
+	}
+	return std::max(doc.line(row_index).chunk(0).entry_state, 0);
+}
+
+// Update a row. Returns false if the row was highlighted again, in which case
+// the state at the end of it may have changed, and the row below it has to be
+// checked too.
+bool editor::update(int row_index) {
 	// Reject non-existant rows.
-	if (row_index < 0) {
+	if (row_index < 0 || row_index >= doc.size()) {
+		return true;
+	}
+
+	// Rows are only highlighted in the syntax highlighting modes.
+	chunk_lexer lex = syntax_engines[highlight].lex;
+	if (!lex) {
+		return true;
+	}
+
+	// Find out if the upper row is open.
+	int state = upper_state(row_index);
+	bool upper_open = state & ls_open;
+
+	// Rows remember the state they were highlighted from, which is reset
+	// when they are edited, so a row that was highlighted from the same state
+	// before is up to date.
+	row& current = doc.line(row_index);
+	if (!current.chunked() && current.entry_state == state) {
+		return true;
+	}
+
+	// Do syntax highlighting, a chunk at a time for long rows. The lexer
+	// state is carried from each chunk to the next, and chunks of long rows
+	// that were highlighted from the same state before are up to date, so
+	// an edit only highlights its own chunk again (and the chunks after it,
+	// if its state at the end changed). Long rows are highlighted up to the
+	// chunk in view, and after that for a few milliseconds at a time; the
+	// rest of the row is highlighted when the editor is idle, and until then
+	// the row keeps the state it had at its end.
+	size_t visible = current.chunk_of(
+		current.character_x(scroll_x + vga_text_mode_x_res)
+	);
+	Uint32 start = SDL_GetTicks();
+	bool lexed = false;
+	for (size_t k = 0; k < current.chunk_count(); k++) {
+		row& chunk = current.chunk(k);
+		if (!current.chunked() || chunk.entry_state != state) {
+			if (k > visible && SDL_GetTicks() - start >= 8) {
+				return false;
+			}
+			lexed = true;
+			#ifdef ALLOCATION_STATS
+			size_t heap_before = heap_allocations;
+			size_t arena_before = storage.allocations;
+			#endif
+			lex(chunk, state, k > 0);
+			#ifdef ALLOCATION_STATS
+			lexed_rows++;
+			lexed_heap_allocations += heap_allocations - heap_before;
+			lexed_arena_allocations += storage.allocations - arena_before;
+			#endif
+		}
+		state = chunk.exit_state;
+	}
+
+	// Mark the row as open if it ended in an open multiline comment.
+	current.open = state & ls_open;
+
+	// If the row's length is zero, set the row's state to to the state of
+	// the upper row.
+	if (current.size() == 0) {
+		current.open = upper_open;
+	}
+
+	return !lexed;
+}
+
+// Highlight the rows that need it, up to the bottom of the view. The dirty
+// rows are highlighted again in order, and the range is extended a row at a
+// time for as long as rows are highlighted again, so the pass stops at the
+// first row past the edits that was highlighted from the same state before.
+// A pass that reaches the bottom of the view leaves the rest of the range to
+// the rows that come into view later.
+void editor::highlight_view() {
+	int bottom = std::min((int)doc.size(), scroll_y + vga_text_mode_y_res);
+	while (dirty_begin < dirty_end) {
+		// Rows from the watermark on are highlighted as they come into view.
+		if (dirty_begin >= highlighted) {
+			break;
+		} else if (dirty_begin >= bottom) {
+			highlighted = std::min(dirty_begin, (int)doc.size());
+			break;
+		}
+		if (!update(dirty_begin++) && dirty_begin == dirty_end) {
+			dirty_end++;
+		}
+	}
+	if (dirty_begin >= dirty_end || dirty_begin >= highlighted) {
+		dirty_begin = dirty_end = 0;
+	}
+
+	// Highlight the rows that come into view. Rows below the watermark were
+	// highlighted before, and are up to date unless the state above them
+	// changed. If the view is more than a screen below the highlighted rows,
+	// the rows in between are skipped, and the rows in view are highlighted
+	// on their own, starting from the state that the background highlighter
+	// found for them.
+	if (skips_ahead()) {
+		for (int i = scroll_y; i < bottom; i++) {
+			update(i);
+		}
+	} else {
+		while (highlighted < bottom) {
+			update(highlighted++);
+		}
+	}
+}
+
+// Check if the view is more than a screen below the highlighted rows, in which
+// case the rows in view are highlighted on their own.
+bool editor::skips_ahead() {
+	return scroll_y - highlighted > vga_text_mode_y_res;
+}
+
+// Mark a range of rows as needing to be highlighted again.
+void editor::mark_dirty(int begin, int end) {
+	begin = std::max(begin, 0);
+	end = std::min(end, highlighted);
+	if (begin >= end) {
 		return;
-	} else if (row_index >= rows.size()) {
+	}
+	if (dirty_begin >= dirty_end) {
+		dirty_begin = begin;
+		dirty_end = end;
+	} else {
+		dirty_begin = std::min(dirty_begin, begin);
+		dirty_end = std::max(dirty_end, end);
+	}
+}
+
+// Mark an edited row as needing to be highlighted again. Lines is the amount
+// of rows that were inserted below the row, or removed below it if negative;
+// the rows below them move along with the watermark and the dirty range.
+void editor::invalidate(int row_index, int lines) {
+	if (row_index < highlighted) {
+		highlighted = std::max(highlighted + lines, row_index + 1);
+	}
+	if (row_index < dirty_end) {
+		dirty_end = std::max(dirty_end + lines, row_index + 1);
+		if (dirty_begin > row_index) {
+			dirty_begin = std::max(dirty_begin + lines, row_index + 1);
+		}
+	}
+	mark_dirty(row_index, row_index + 1 + std::max(lines, 0));
+	background.edit(row_index, lines);
+	search_edit = std::min<size_t>(search_edit, row_index);
+	version++;
+}
+
+// Insert text into a row.
+void editor::insert_text(int line,
+						 int column,
+						 const char* text,
+						 size_t length)
+{
+	if (length == 0) {
 		return;
 	}
+	doc.line(line).insert(column, text, length);
+	history.record(edit(ed_insert_text, line, column, std::string(text, length)));
+	follow(ed_insert_text, line, column, length);
+	invalidate(line);
+}
+
+// Erase text from a row.
+void editor::erase_text(int line, int column, size_t length) {
+	row& current = doc.line(line);
+	std::string erased;
+	for (size_t i = 0; i < length; i++) {
+		erased += current[column + i];
+	}
+	current.erase(column, length);
+	history.record(edit(ed_erase_text, line, column, erased));
+	follow(ed_erase_text, line, column, length);
+	invalidate(line);
+}
+
+// Split a row in two at a column.
+void editor::split_line(int line, int column) {
+	row right = doc.line(line).split(column);
+	doc.insert(line + 1, std::move(right));
+	history.record(edit(ed_split_line, line, column));
+	follow(ed_split_line, line, column, 0);
+	invalidate(line, 1);
+}
+
+// Join a row with the row below it.
+void editor::join_line(int line) {
+	row& upper = doc.line(line);
+	int column = upper.size();
+	upper.append(doc.line(line + 1));
+	doc.erase(line + 1);
+	history.record(edit(ed_join_line, line, column));
+	follow(ed_join_line, line, column, 0);
+	invalidate(line, -1);
+}
+
+// Insert newline-separated text as whole rows before a row. Returns the
+// amount of inserted rows.
+int editor::insert_lines(int line, const char* text, size_t length) {
+	int count = doc.insert_lines(line, text, length);
+	history.record(edit(ed_insert_lines, line, 0, "", count));
+	follow(ed_insert_lines, line, 0, count);
+	invalidate(line, count);
+	return count;
+}
 
-	// Do syntax highlighting.
-	if (highlight == hm_c) {
-		// Find out if the upper row is open.
-		bool upper_open = false;
-		if (row_index - 1 >= 0) {
-			upper_open = rows[row_index - 1].open;
+// Erase whole rows. The rows are detached from the document and kept by the
+// journal, so erasing any amount of rows is a single tree operation.
+void editor::erase_lines(int line, int count) {
+	edit erased(ed_erase_lines, line, 0, "", count);
+	erased.lines = doc.detach(line, count);
+	history.record(erased);
+	follow(ed_erase_lines, line, 0, count);
+	invalidate(line, -count);
+}
+
+// Paste text at a position. The row is split at the position, the first and
+// last line of the text are added to either half, and the lines in between
+// are inserted as a single piece, so a paste costs the same however many
+// lines it has. Cursors at the position end up after the pasted text.
+void editor::splice(int line, int column, const char* text, size_t length) {
+	// Find the first and the last newline.
+	const char* first = (const char*)memchr(text, '\n', length);
+	if (!first) {
+		insert_text(line, column, text, length);
+		return;
+	}
+	const char* last = text + length - 1;
+	while (*last != '\n') {
+		last--;
+	}
+
+	// Split the row, and add the first line of the text to the upper half.
+	split_line(line, column);
+	insert_text(line, column, text, first - text);
+	line++;
+
+	// Insert the lines in between.
+	if (last > first) {
+		line += insert_lines(line, first + 1, last - first);
+	}
+
+	// Add the last line of the text to the lower half.
+	insert_text(line, 0, last + 1, text + length - last - 1);
+}
+
+// Move every cursor along with an edit, so that it stays on the same text.
+// The cursor that the edit was made at ends up after inserted text, or at
+// the position of erased text.
+void editor::follow(edit_kind kind, int line, int column, int count) {
+	each_cursor([&](int& x, int& y) {
+		if (kind == ed_insert_text) {
+			if (y == line && x >= column) {
+				x += count;
+			}
+		} else if (kind == ed_erase_text) {
+			if (y == line && x > column) {
+				x = std::max(x - count, column);
+			}
+		} else if (kind == ed_split_line) {
+			if (y == line && x >= column) {
+				x -= column;
+				y++;
+			} else if (y > line) {
+				y++;
+			}
+		} else if (kind == ed_join_line) {
+			if (y == line + 1) {
+				x += column;
+				y--;
+			} else if (y > line + 1) {
+				y--;
+			}
+		} else if (kind == ed_insert_lines) {
+			if (y >= line) {
+				y += count;
+			}
+		} else if (kind == ed_erase_lines) {
+			if (y >= line + count) {
+				y -= count;
+			} else if (y >= line) {
+				x = 0;
+				y = line;
+			}
+		}
+	});
+}
+
+// Clamp the extra cursors to the document, and merge cursors that are at the
+// same position.
+void editor::merge_cursors() {
+	std::vector<caret> merged;
+	for (size_t i = 0; i < carets.size(); i++) {
+		caret c = carets[i];
+		c.y = std::max(0, std::min(c.y, int(doc.size()) - 1));
+		c.x = std::max(0, std::min(c.x, int(doc.line(c.y).size())));
+		if (c.x == cursor_x && c.y == cursor_y) {
+			continue;
+		}
+		bool duplicate = false;
+		for (size_t j = 0; j < merged.size() && !duplicate; j++) {
+			duplicate = merged[j].x == c.x && merged[j].y == c.y;
+		}
+		if (!duplicate) {
+			merged.push_back(c);
 		}
+	}
+	carets.swap(merged);
+}
 
-		unsigned int i = 0;
-		HI_c::tokenizer tokenizer(rows[row_index]);
+// Add an extra cursor.
+void editor::add_cursor(int x, int y) {
+	carets.push_back({x, y});
+	merge_cursors();
+}
+
+// Add an extra cursor at the next occurrence of the word at the newest
+// cursor, at the same offset into the word. The search wraps around to the
+// start of the document.
+void editor::add_next_occurrence() {
+	caret from = {cursor_x, cursor_y};
+	if (!carets.empty()) {
+		from = carets.back();
+	}
+
+	// Find the word at the newest cursor.
+	std::string line = doc.text(from.y);
+	auto is_word = [](char c) {
+		return isalnum((unsigned char)c) || c == '_';
+	};
+	int start = std::min(from.x, int(line.size()));
+	int end = start;
+	while (start > 0 && is_word(line[start - 1])) {
+		start--;
+	}
+	while (end < line.size() && is_word(line[end])) {
+		end++;
+	}
+	if (start == end) {
+		return;
+	}
+	std::string word = line.substr(start, end - start);
+	int offset = from.x - start;
+
+	// Search the following lines for the next whole-word occurrence.
+	size_t column = end;
+	for (size_t i = 0; i <= doc.size(); i++) {
+		size_t y = (from.y + i) % doc.size();
+		if (i > 0) {
+			line = doc.text(y);
+			column = 0;
+		}
 		for (;;) {
-			// Fetch the next token.
-			HI_c::token token = tokenizer.next(upper_open);
-			// Break if the end-of-file was encountered.
-			if (token.type == HI_c::tk_eof) {
+			column = line.find(word, column);
+			if (column == std::string::npos) {
 				break;
 			}
-			// Color the segment of the row represented by the last fetched
-			// token.
-			vga_color color = HI_c::token_to_color[token.type];
-			for (unsigned int j = 0; j < token.text.length(); j++) {
-				if (i < rows[row_index].size()) {
-					rows[row_index][i++].fg = color;
-				}
+			size_t after = column + word.size();
+			if ((column == 0 || !is_word(line[column - 1])) &&
+				(after == line.size() || !is_word(line[after])))
+			{
+				add_cursor(column + offset, y);
+				return;
 			}
+			column = after;
 		}
+	}
+}
+
+// Convert a character index of a row to a display column.
+int editor::display_x(int x, int y) {
+	return doc.line(y).display_x(std::max(x, 0));
+}
 
-		// Remember if the row was closed or open before doing syntax
-		// highlighting.
-		bool open = rows[row_index].open;
+// Convert a display column of a row to the index of the character that is
+// shown there (or the end of the row).
+int editor::character_x(int display_x, int y) {
+	return doc.line(y).character_x(std::max(display_x, 0));
+}
 
-		// Mark the row as open if the tokenizer was marked as open.
-		rows[row_index].open = tokenizer.open;
+// Scroll horizontally so that the cursor is in view. The view moves a
+// quarter of its width past the cursor, so that typing at the edge of the
+// view does not scroll on every key.
+void editor::reveal() {
+	int width = vga_text_mode_x_res - 8;
+	int real_x = display_x(cursor_x, cursor_y);
+	if (real_x < scroll_x) {
+		scroll_x = std::max(real_x - width / 4, 0);
+	} else if (real_x >= scroll_x + width) {
+		scroll_x = real_x - width + width / 4 + 1;
+	}
+}
 
-		// If the row's length is zero, set the row's state to to the state of
-		// the upper row.
-		if (rows[row_index].size() == 0) {
-			rows[row_index].open = upper_open;
+// Move a cursor with an arrow key.
+void editor::move(int& x, int& y, SDL_Keycode key) {
+	if (key == SDLK_LEFT) {
+		x--;
+		if (x == -1) {
+			if (y != 0) {
+				x = doc.line(--y).size();
+			} else {
+				x = 0;
+			}
 		}
+	} else if (key == SDLK_RIGHT) {
+		x++;
+		if (x > doc.line(y).size()) {
+			if (y + 1 < doc.size()) {
+				x = 0;
+				y++;
+			}
+		}
+	} else if (key == SDLK_UP) {
+		y--;
+	} else if (key == SDLK_DOWN) {
+		y++;
+	}
+}
+
+// Mouse click handler. A click moves the cursor, and a click with the
+// control key held adds an extra cursor.
+void editor::click(int x, int y, bool add) {
+	// Ignore clicks on the status bar and the line numbers.
+	if (y < 1 || x < 8) {
+		return;
+	}
+	doc.reach(scroll_y + y);
+	int line = std::min(scroll_y + y - 1, int(doc.size()) - 1);
+	int column = character_x(x - 8 + scroll_x, line);
+	if (add) {
+		add_cursor(column, line);
+	} else {
+		carets.clear();
+		cursor_x = column;
+		cursor_y = line;
+	}
+	motion_tick = SDL_GetTicks();
+}
+
+// Apply or revert an edit that was recorded in the journal.
+void editor::apply(edit& e, bool revert) {
+	// Reverting an insertion is applying an erasure, and vice versa.
+	edit_kind kind = e.kind;
+	if (revert) {
+		edit_kind inverse[] = {
+			ed_erase_text,
+			ed_insert_text,
+			ed_join_line,
+			ed_split_line,
+			ed_erase_lines,
+			ed_insert_lines
+		};
+		kind = inverse[e.kind];
+	}
 
-		// If the row was closed or opened, update the following row.
-		if (rows[row_index].open != open) {
-			update(row_index + 1);
+	int lines = 0;
+	if (kind == ed_insert_text) {
+		doc.line(e.line).insert(e.column, e.text.data(), e.text.size());
+	} else if (kind == ed_erase_text) {
+		doc.line(e.line).erase(e.column, e.text.size());
+	} else if (kind == ed_split_line) {
+		row right = doc.line(e.line).split(e.column);
+		doc.insert(e.line + 1, std::move(right));
+		lines = 1;
+	} else if (kind == ed_join_line) {
+		doc.line(e.line).append(doc.line(e.line + 1));
+		doc.erase(e.line + 1);
+		lines = -1;
+	} else if (kind == ed_insert_lines) {
+		// Attach the detached lines again, or insert the spilled text.
+		if (e.lines) {
+			doc.attach(e.line, e.lines);
+			e.lines = NULL;
+			lines = e.count;
+		} else {
+			lines = doc.insert_lines(e.line, e.text.data(), e.text.size());
+			// Free the text, so that it is not counted against the memory
+			// cap of the journal.
+			std::string().swap(e.text);
 		}
-	} else if (highlight == hm_cpp) {
-		// Find out if the upper row is open.
-		bool upper_open = false;
-		if (row_index - 1 >= 0) {
-			upper_open = rows[row_index - 1].open;
+		if (lines != e.count) {
+			barf("The undo history does not match the document.");
 		}
+	} else if (kind == ed_erase_lines) {
+		e.lines = doc.detach(e.line, e.count);
+		lines = -e.count;
+	}
+	invalidate(e.line, lines);
+}
 
-		unsigned int i = 0;
-		HI_cpp::tokenizer tokenizer(rows[row_index]);
-		for (;;) {
-			// Fetch the next token.
-			HI_cpp::token token = tokenizer.next(upper_open);
-			// Break if the end-of-file was encountered.
-			if (token.type == HI_cpp::tk_eof) {
-				break;
-			}
-			// Color the segment of the row represented by the last fetched
-			// token.
-			vga_color color = HI_cpp::token_to_color[token.type];
-			for (unsigned int j = 0; j < token.text.length(); j++) {
-				if (i < rows[row_index].size()) {
-					rows[row_index][i++].fg = color;
-				}
-			}
+// Undo the last transaction.
+void editor::undo() {
+	if (history.past.empty()) {
+		return;
+	}
+	transaction t = history.pop(history.past);
+	for (size_t i = t.edits.size(); i-- > 0;) {
+		apply(t.edits[i], true);
+	}
+	cursor_x = t.cursor_x_before;
+	cursor_y = t.cursor_y_before;
+	carets.clear();
+	history.push(history.future, std::move(t));
+}
+
+// Redo the last undone transaction.
+void editor::redo() {
+	if (history.future.empty()) {
+		return;
+	}
+	transaction t = history.pop(history.future);
+	for (size_t i = 0; i < t.edits.size(); i++) {
+		apply(t.edits[i], false);
+	}
+	cursor_x = t.cursor_x_after;
+	cursor_y = t.cursor_y_after;
+	carets.clear();
+	history.push(history.past, std::move(t));
+}
+
+// Search the document for the query. A new snapshot of the document is
+// taken if it has been edited since the last one, and the search carries on
+// from the first edited row if the query is the same.
+void editor::find() {
+	if (searched != version) {
+		if (searched != (size_t)-1) {
+			search.resume(doc, search_edit);
+		} else {
+			search.snapshot(doc);
 		}
+		searched = version;
+		search_edit = -1;
+	}
+	if (regex_mode) {
+		pattern.compile(query);
+	}
+	search.start(query, regex_mode);
+}
 
-		// Remember if the row was closed or open before doing syntax
-		// highlighting.
-		bool open = rows[row_index].open;
+// Move the cursor to the next match of the search, and scroll it into view.
+void editor::find_next() {
+	search.collect();
+	search_match* match = search.next(cursor_y, cursor_x);
+	if (!match) {
+		return;
+	}
+	doc.reach(match->line + 1);
+	cursor_x = match->column;
+	cursor_y = match->line;
+	carets.clear();
+	if (cursor_y < scroll_y || cursor_y + 2 > vga_text_mode_y_res + scroll_y) {
+		scroll_y = std::max(cursor_y - vga_text_mode_y_res / 2, 0);
+	}
+	reveal();
+}
 
-		// Mark the row as open if the tokenizer was marked as open.
-		rows[row_index].open = tokenizer.open;
+// Replace every match of the search in the document. The new content of the
+// document is built in one pass over its pieces, and swapped in as a single
+// transaction (the new lines are inserted, and the old lines are detached),
+// instead of editing the rows match by match.
+void editor::replace_all() {
+	// Compile the query. Plain queries match themselves.
+	regex expression;
+	if (query.empty() ||
+		!expression.compile(regex_mode ? query : regex_escape(query)))
+	{
+		return;
+	}
 
-		// If the row's length is zero, set the row's state to to the state of
-		// the upper row.
-		if (rows[row_index].size() == 0) {
-			rows[row_index].open = upper_open;
+	// Build the new content of the whole document. Pieces hold whole lines,
+	// and every line of the new content ends with a newline.
+	while (!doc.complete()) {
+		doc.extend();
+	}
+	Uint64 start = SDL_GetPerformanceCounter();
+	std::string content;
+	size_t replaced = 0;
+	doc.pieces([&](const char* data,
+				   size_t begin,
+				   size_t end,
+				   size_t,
+				   bool)
+	{
+		if (end > begin && data[end - 1] == '\n') {
+			end--;
 		}
+		replaced += regex_replace(
+			expression,
+			data + begin,
+			end - begin,
+			replacement,
+			content
+		);
+		content += '\n';
+	});
+
+	// Swap the new content in.
+	if (replaced > 0) {
+		history.begin(tr_other, cursor_x, cursor_y);
+		int x = cursor_x;
+		int y = cursor_y;
+		int count = doc.size();
+		erase_lines(insert_lines(0, content.data(), content.size()), count);
+		cursor_y = std::min(y, int(doc.size()) - 1);
+		cursor_x = std::min(x, int(doc.line(cursor_y).size()));
+		carets.clear();
+		history.finish(cursor_x, cursor_y);
+	}
+	double seconds = double(
+		SDL_GetPerformanceCounter() - start
+	) / double(SDL_GetPerformanceFrequency());
+
+	// Show the amount of replaced matches in the status bar.
+	std::stringstream message_stream;
+	message_stream << std::fixed << std::setprecision(1);
+	message_stream << "Replaced " << replaced << " matches in ";
+	message_stream << seconds * 1000.0 << " ms";
+	message = message_stream.str();
+	message_tick = SDL_GetTicks();
+}
 
-		// If the row was closed or opened, update the following row.
-		if (rows[row_index].open != open) {
-			update(row_index + 1);
+// Keypress handler while searching. Text is typed into the query (or into the
+// replacement) instead of the document. Returns false if the key should be
+// handled as usual.
+bool editor::find_key(SDL_Event e) {
+	std::string& field = replacing ? replacement : query;
+	if (e.type == SDL_TEXTINPUT) {
+		field += e.text.text;
+		if (!replacing) {
+			find();
+		}
+	} else if (e.type != SDL_KEYDOWN) {
+		return false;
+	} else if (e.key.keysym.sym == SDLK_h && e.key.keysym.mod == KMOD_LCTRL) {
+		// Start typing the replacement.
+		replacing = true;
+		replacement.clear();
+	} else if (e.key.keysym.sym == SDLK_BACKSPACE) {
+		if (!field.empty()) {
+			field.erase(field.size() - 1);
+			if (!replacing) {
+				find();
+			}
+		}
+	} else if (e.key.keysym.sym == SDLK_RETURN) {
+		if (replacing) {
+			replace_all();
+			replacing = false;
+		} else {
+			find_next();
 		}
+	} else if (e.key.keysym.sym == SDLK_ESCAPE) {
+		if (replacing) {
+			replacing = false;
+		} else {
+			finding = false;
+			search.cancel();
+			searched = -1;
+		}
+	} else {
+		return false;
 	}
+	motion_tick = SDL_GetTicks();
+	return true;
 }
 
 // Keypress handler.
 void editor::key(SDL_Event e) {
+	// Type into the query while searching.
+	if (finding && find_key(e)) {
+		return;
+	}
+
 	if (e.type == SDL_KEYDOWN) {
 		SDL_Keycode key = e.key.keysym.sym;
 
+		// Handle SDLK_f with a left-control modifier.
+		if (key == SDLK_f && e.key.keysym.mod == KMOD_LCTRL) {
+			// Start searching, or move to the next match.
+			if (finding) {
+				find_next();
+			} else {
+				finding = true;
+				regex_mode = false;
+				find();
+			}
+			return;
+		}
+
+		// Handle SDLK_r with a left-control modifier.
+		if (key == SDLK_r && e.key.keysym.mod == KMOD_LCTRL) {
+			// Start searching for a regular expression, or switch between
+			// regular expressions and plain text while searching.
+			regex_mode = finding ? !regex_mode : true;
+			finding = true;
+			find();
+			return;
+		}
+
 		// Handle keys with a left-control modifier.
 		if (e.key.keysym.mod == KMOD_LCTRL) {
 			bool realloc_text = true;
@@ -249,50 +974,57 @@ void editor::key(SDL_Event e) {
 			}
 
 			if (key == SDLK_v) {
-				// Paste text.
-				std::string text = SDL_GetClipboardText();
-				std::stringstream text_stream(text);
-				std::vector<std::string> lines;
-				std::string line;
-				while (std::getline(text_stream, line)) {
-					lines.push_back(line);
-				}
-				if (lines.size() == 1) {
-					rows[cursor_y].insert_str(cursor_x, lines[0]);
-					cursor_x += text.size();
-				} else if (lines.size() > 1) {
-					rows[cursor_y].insert_str(cursor_x, lines[0]);
-					for (int i = 1; i < lines.size(); i++) {
-						rows.insert(rows.begin() + ++cursor_y, row(lines[i]));
-						update(cursor_y);
-					}
-					cursor_x = rows[cursor_y].size();
+				// Paste text at every cursor.
+				char* text = SDL_GetClipboardText();
+				if (text && *text) {
+					history.begin(tr_other, cursor_x, cursor_y);
+					size_t length = strlen(text);
+					each_cursor([&](int& x, int& y) {
+						splice(y, x, text, length);
+					});
 				}
+				SDL_free(text);
 			} else if (key == SDLK_s) {
-				// Save the file.
-				std::ofstream file(filename);
-				if (file.is_open()) {
-					for (int i = 0; i < rows.size(); i++) {
-						file << rows[i].to_string();
-						if (i < rows.size() - 1) {
-							file << '\n';
-						}
-					}
-					file.close();
+				// Save the file. The memory mapped original stays intact
+				// while it is being read, because the document is written to
+				// a temporary file that is renamed over the file.
+				Uint64 start = SDL_GetPerformanceCounter();
+				bool saved = writer.save(doc, filename);
+				double seconds = double(
+					SDL_GetPerformanceCounter() - start
+				) / double(SDL_GetPerformanceFrequency());
+				// Show the throughput in the status bar.
+				std::stringstream message_stream;
+				if (saved) {
+					double megabytes = writer.written / 1048576.0;
+					message_stream << std::fixed << std::setprecision(1);
+					message_stream << "Saved " << megabytes << " MB in ";
+					message_stream << seconds * 1000.0 << " ms (";
+					message_stream << megabytes / std::max(seconds, 1e-6);
+					message_stream << " MB/s)";
+				} else {
+					message_stream << "Could not save " << filename;
 				}
+				message = message_stream.str();
+				message_tick = SDL_GetTicks();
 			} else if (key == SDLK_b) {
 				// Save the video buffer.
 				save_video = true;
+			} else if (key == SDLK_z) {
+				// Undo the last transaction.
+				undo();
+			} else if (key == SDLK_y) {
+				// Redo the last undone transaction.
+				redo();
+			} else if (key == SDLK_d) {
+				// Add a cursor at the next occurrence of the word at the
+				// newest cursor.
+				add_next_occurrence();
 			}
 
 			if (realloc_text) {
 				// Reallocate the text buffer.
-				free(text);
-				text = (glyph*)malloc(
-					vga_text_mode_x_res *
-					vga_text_mode_y_res *
-					sizeof(glyph)
-				);
+				allocate_text();
 			}
 
 			// Scroll up if the cursor is above the viewport.
@@ -310,34 +1042,50 @@ void editor::key(SDL_Event e) {
 			}
 		}
 
-		// Handle SDLK_BACKSPACE.
-		if (key == SDLK_BACKSPACE) {
-			if (rows[cursor_y].size() < 1 && cursor_y > 0) {
-				// Line is empty, so remove the line, and move the cursor to the
-				// end of the upper line.
-				rows.erase(rows.begin() + cursor_y--);
-				cursor_x = rows[cursor_y].size();
-			} else {
-				// Line is not empty.
-				if (cursor_x == 0) {
-					// Cursor is on the first character, so remove the line, add
-					// it to the end of the upper line and move the cursor to
-					// the previous end of the upper line.
-					if (cursor_y <= 0) {
-						return;
-					}
-					cursor_x = rows[cursor_y - 1].size();
-					rows[cursor_y - 1].append(rows[cursor_y]);
-					rows.erase(rows.begin() + cursor_y);
-					cursor_y--;
+		// Handle SDLK_UP and SDLK_DOWN with a left-alt modifier.
+		if ((key == SDLK_UP || key == SDLK_DOWN) &&
+			e.key.keysym.mod == KMOD_LALT)
+		{
+			// Add a cursor above the topmost cursor (or below the
+			// bottommost cursor), at the display column of the cursor.
+			int y = cursor_y;
+			for (size_t i = 0; i < carets.size(); i++) {
+				if (key == SDLK_UP) {
+					y = std::min(y, carets[i].y);
 				} else {
-					// Cursor is not on the first character, so remove the
-					// character before the cursor, and move the cursor to the
-					// left.
-					rows[cursor_y].erase(rows[cursor_y].begin() + cursor_x - 1);
-					cursor_x--;
+					y = std::max(y, carets[i].y);
 				}
 			}
+			y += key == SDLK_UP ? -1 : 1;
+			doc.reach(y + 1);
+			if (y >= 0 && y < doc.size()) {
+				add_cursor(character_x(display_x(cursor_x, cursor_y), y), y);
+			}
+		}
+
+		// Handle SDLK_ESCAPE.
+		else if (key == SDLK_ESCAPE) {
+			// Remove the extra cursors.
+			carets.clear();
+		}
+
+		// Handle SDLK_BACKSPACE.
+		else if (key == SDLK_BACKSPACE) {
+			// Remove the character before every cursor. If a cursor is on the
+			// first character (or the line is empty), remove the line and add
+			// it to the end of the upper line instead.
+			history.begin(
+				cursor_x > 0 ? tr_erasing : tr_other,
+				cursor_x,
+				cursor_y
+			);
+			each_cursor([this](int& x, int& y) {
+				if (x > 0) {
+					erase_text(y, x - 1, 1);
+				} else if (y > 0) {
+					join_line(y - 1);
+				}
+			});
 			// Scroll up if the cursor is above the viewport.
 			if (cursor_y < scroll_y) {
 				scroll_y--;
@@ -346,23 +1094,13 @@ void editor::key(SDL_Event e) {
 
 		// Handle SDLK_RETURN.
 		else if (key == SDLK_RETURN) {
-			if (cursor_x == 0) {
-				// Cursor is at the start of the row. Create a new row above the
-				// cursor and move the cursor down.
-				rows.insert(rows.begin() + cursor_y++, row());
-			} else if (cursor_x == rows[cursor_y].size()) {
-				// Cursor is at the end of the row. Create a new row below the
-				// cursor and move the cursor down.
-				rows.insert(rows.begin() + ++cursor_y, row());
-			} else {
-				// Cursor is somewhere inside the row. Split the row and move
-				// the right half to another line (below the current line). Then
-				// remove the right half from the current line. Finally, move
-				// the cursor to the start of the first line.
-				row row_right = rows[cursor_y].split(cursor_x);
-				rows.insert(rows.begin() + ++cursor_y, row_right);
-				cursor_x = 0;
-			}
+			// Split the row at every cursor and move the right half to
+			// another line (below the current line). The cursors move to
+			// the start of the new lines.
+			history.begin(tr_other, cursor_x, cursor_y);
+			each_cursor([this](int& x, int& y) {
+				split_line(y, x);
+			});
 			// Scroll down if the cursor is below the viewport.
 			if (cursor_y + 2 > vga_text_mode_y_res + scroll_y) {
 				scroll_y++;
@@ -371,84 +1109,72 @@ void editor::key(SDL_Event e) {
 
 		// Handle SDLK_TAB.
 		else if (key == SDLK_TAB) {
-			rows[cursor_y].insert_str(cursor_x++, "\t");
-		}
-
-		// Handle SDLK_LEFT.
-		else if (key == SDLK_LEFT) {
-			cursor_x--;
-			if (cursor_x == -1) {
-				if (cursor_y != 0) {
-					cursor_x = rows[--cursor_y].size();
-				} else {
-					cursor_x = 0;
-				}
-			}
-			// Scroll up if the cursor is above the viewport.
-			if (cursor_y < scroll_y) {
-				scroll_y--;
-			}
-		}
-		// Handle SDLK_RIGHT.
-		else if (key == SDLK_RIGHT) {
-			cursor_x++;
-			if (cursor_x > rows[cursor_y].size()) {
-				if (cursor_y + 1 < rows.size()) {
-					cursor_x = 0;
-					cursor_y++;
-				}
-			}
-			// Scroll down if the cursor is below the viewport.
-			if (cursor_y + 2 > vga_text_mode_y_res + scroll_y) {
-				scroll_y++;
-			}
+			history.begin(tr_typing, cursor_x, cursor_y);
+			each_cursor([this](int& x, int& y) {
+				insert_text(y, x, "\t", 1);
+			});
 		}
 
-		// Handle SDLK_UP.
-		else if (key == SDLK_UP) {
-			cursor_y--;
+		// Handle the arrow keys.
+		else if (key == SDLK_LEFT ||
+				 key == SDLK_RIGHT ||
+				 key == SDLK_UP ||
+				 key == SDLK_DOWN)
+		{
+			// Move every cursor.
+			each_cursor([this, key](int& x, int& y) {
+				move(x, y, key);
+			});
 			// Scroll up if the cursor is above the viewport.
 			if (cursor_y < scroll_y) {
 				scroll_y--;
 			}
-		}
-		// Handle SDLK_DOWN.
-		else if (key == SDLK_DOWN) {
-			cursor_y++;
 			// Scroll down if the cursor is below the viewport.
 			if (cursor_y + 2 > vga_text_mode_y_res + scroll_y) {
 				scroll_y++;
 			}
 		}
 
-		else {
+		else if (e.key.keysym.mod != KMOD_LCTRL) {
 			return;
 		}
 	}
 	else if (e.type == SDL_TEXTINPUT) {
-		// Insert the inputted text into the current row at the current position
-		// of the cursor, and move the cursor to the right.
-		rows[cursor_y].insert_str(cursor_x, e.text.text);
-		cursor_x += strlen(e.text.text);
+		// Insert the inputted text into the rows at the positions of the
+		// cursors, and move the cursors to the right.
+		history.begin(tr_typing, cursor_x, cursor_y);
+		size_t length = strlen(e.text.text);
+		each_cursor([&](int& x, int& y) {
+			insert_text(y, x, e.text.text, length);
+		});
 	}
 	else {
 		return;
 	}
 
+	// Index the file until the cursor's row is reached.
+	doc.reach(cursor_y + 1);
+
 	// Clamp cursor_x and cursor_y.
 	if (cursor_y < 0) {
 		cursor_y = 0;
-	} else if (cursor_y >= rows.size()) {
-		cursor_y = rows.size() - 1;
+	} else if (cursor_y >= doc.size()) {
+		cursor_y = doc.size() - 1;
 	}
 
-	if (cursor_x > rows[cursor_y].size()) {
-		cursor_x = rows[cursor_y].size();
+	if (cursor_x > doc.line(cursor_y).size()) {
+		cursor_x = doc.line(cursor_y).size();
 	}
 	if (cursor_x < 0) {
 		cursor_x = 0;
 	}
 
+	// Clamp and merge the extra cursors.
+	merge_cursors();
+
+	// Scroll the cursor into view horizontally.
+	reveal();
+
 	// Clamp scroll_x and scroll_y.
 	if (scroll_x < 0) {
 		scroll_x = 0;
@@ -457,10 +1183,15 @@ void editor::key(SDL_Event e) {
 		scroll_y = 0;
 	}
 
-	// Update the current, upper, and lower rows.
-	update(cursor_y);
-	update(cursor_y - 1);
-	update(cursor_y + 1);
+	// Finish recording the edits of this keypress. The edited rows are
+	// highlighted again when they are rendered.
+	if (history.finish(cursor_x, cursor_y)) {
+		#ifdef ALLOCATION_STATS
+		if (report_edits) {
+			report("Edit");
+		}
+		#endif
+	}
 
 	// Set the motion tick value to the current tick to prevent blinking for the
 	// next few frames.
@@ -479,29 +1210,113 @@ void editor::render() {
 	// Clear the text buffer.
 	memset(text, 0, text_length);
 
+	// Index and highlight all of the rows that are in view.
+	doc.reach(scroll_y + vga_text_mode_y_res);
+	highlight_view();
+
 	// Store the printer head's Y position.
 	int y = scroll_y;
 	// Print all of the rows to the text buffer.
-	for (unsigned int j = scroll_y; j < rows.size(); j++) {
-		// Store the printer head's X position.
-		int x = 8;
-
+	for (unsigned int j = scroll_y; j < doc.size(); j++) {
 		// Fetch the current row.
-		row row = rows[j];
-		// Print the current row to the text buffer.
-		for (unsigned int i = 0; i < row.size(); i++) {
-			// Fetch the current glyph.
-			glyph glyph = row[i];
+		row& row = doc.line(j);
+		// Find the first character in view with the display column index of
+		// the row, and store the printer head's X position there.
+		unsigned int first = row.character_x(scroll_x);
+		int x = 8 + row.display_x(first);
+		// Store the chunk of the first character (long rows keep their color
+		// spans in their chunks), and the index of its color span.
+		size_t k = row.chunk_of(first);
+		size_t chunk_start = row.chunk_start(k);
+		size_t chunk_end = chunk_start + row.chunk(k).size();
+		span_list* spans = &row.chunk(k).spans;
+		unsigned int s = std::lower_bound(
+			spans->begin(),
+			spans->end(),
+			first - chunk_start,
+			[](const span& a, size_t i) {
+				return a.start + a.length <= i;
+			}
+		) - spans->begin();
+		// Find the matches of the search in the current row, as pairs of
+		// their start and end. The rows in view are searched right away, so
+		// their matches are highlighted before the search worker gets to
+		// them. Long rows are only searched around the part in view.
+		std::vector<size_t>& matches = row_matches;
+		matches.clear();
+		if (finding && !query.empty()) {
+			size_t from = 0;
+			if (row.chunked()) {
+				from = first - std::min<size_t>(first, row_chunk_size);
+				row.copy(row_text, from, 3 * row_chunk_size);
+			} else {
+				row.copy(row_text, 0, row.size());
+			}
+			if (!regex_mode) {
+				size_t match = row_text.find(query);
+				while (match != std::string::npos) {
+					matches.push_back(from + match);
+					matches.push_back(from + match + query.size());
+					match = row_text.find(query, match + query.size());
+				}
+			} else if (pattern.error.empty()) {
+				pattern.find_all(
+					row_text.data(),
+					row_text.size(),
+					[&](size_t start, size_t end) {
+						matches.push_back(from + start);
+						matches.push_back(from + end);
+					}
+				);
+			}
+		}
+		// Store the index of the current match.
+		unsigned int m = 0;
+		// Print the characters of the current row that are in view to the
+		// text buffer.
+		for (unsigned int i = first; i < row.size(); i++) {
+			// Stop at the right edge of the viewport.
+			if (x - scroll_x >= vga_text_mode_x_res) {
+				break;
+			}
+			// Find the match at or after the current character.
+			while (m < matches.size() && matches[m + 1] <= i) {
+				m += 2;
+			}
+			unsigned char bg = vga_black;
+			if (m < matches.size() && matches[m] <= i) {
+				bg = vga_dark_yellow;
+			}
+			// Move on to the next chunk.
+			if (i >= chunk_end) {
+				k++;
+				chunk_start = chunk_end;
+				chunk_end += row.chunk(k).size();
+				spans = &row.chunk(k).spans;
+				s = 0;
+			}
+			// Fetch the current character.
+			char ascii = row.chunk(k)[i - chunk_start];
 			// Handle tabs.
-			if (glyph.ascii == '\t') {
+			if (ascii == '\t') {
 				x = (x / 4) * 4 + 4;
 				continue;
 			}
+			// Find the color of the current character.
+			while (s < spans->size() &&
+				   (*spans)[s].start + (*spans)[s].length <= i - chunk_start)
+			{
+				s++;
+			}
+			unsigned char fg = vga_gray;
+			if (s < spans->size() && (*spans)[s].start <= i - chunk_start) {
+				fg = (*spans)[s].color;
+			}
 			// Handle regular characters.
 			word(
 				x - scroll_x,
 				y - scroll_y + 1,
-				glyph
+				{ascii, fg, bg}
 			);
 			// Increment the printer head's X position.
 			x++;
@@ -534,16 +1349,9 @@ void editor::render() {
 
 	// Find the real cursor X position. The cursor_x variable cannot be relied
 	// on because of wide characters (like tabs).
-	int real_cursor_x = 0;
-	for (int i = 0; i < rows[cursor_y].size() && i < cursor_x; i++) {
-		if (rows[cursor_y][i].ascii == '\t') {
-			real_cursor_x = (real_cursor_x / 4) * 4 + 4;
-		} else {
-			real_cursor_x++;
-		}
-	}
+	int real_cursor_x = display_x(cursor_x, cursor_y);
 
-	// Draw the cursor if the blink timer allows it.
+	// Draw the cursors if the blink timer allows it.
 	if ((SDL_GetTicks() - motion_tick) % 1000 < 500) {
 		// Draw the cursor.
 		word(
@@ -555,6 +1363,25 @@ void editor::render() {
 				vga_black
 			}
 		);
+		// Draw the extra cursors that are in view.
+		for (size_t i = 0; i < carets.size(); i++) {
+			caret c = carets[i];
+			if (c.y < scroll_y || c.y - scroll_y + 1 >= vga_text_mode_y_res) {
+				continue;
+			}
+			if (display_x(c.x, c.y) < scroll_x) {
+				continue;
+			}
+			word(
+				display_x(c.x, c.y) - scroll_x + 8,
+				c.y - scroll_y + 1,
+				{
+					-37,
+					vga_gray,
+					vga_black
+				}
+			);
+		}
 	}
 
 	// Print the status bar background.
@@ -573,10 +1400,40 @@ void editor::render() {
 		word(i + 9 + filename.size(), 0, {syntax[i], vga_black, vga_gray});
 	}
 
+	// Print the status message for a few seconds, or else the query and the
+	// amount of matches while searching ("+" while the search is still
+	// running).
+	if (!message.empty() && SDL_GetTicks() - message_tick < 3000) {
+		int offset = 11 + filename.size() + syntax.size();
+		for (unsigned int i = 0; i < message.size(); i++) {
+			word(i + offset, 0, {message[i], vga_black, vga_gray});
+		}
+	} else if (finding) {
+		std::stringstream find_stream;
+		find_stream << (regex_mode ? "Regex: " : "Find: ") << query;
+		if (replacing) {
+			find_stream << " Replace with: " << replacement;
+		} else if (regex_mode && !pattern.error.empty()) {
+			find_stream << " (invalid pattern)";
+		} else {
+			find_stream << " (" << search.count;
+			find_stream << (search.complete() ? "" : "+") << " matches)";
+		}
+		std::string find_status = find_stream.str();
+		int offset = 11 + filename.size() + syntax.size();
+		for (unsigned int i = 0; i < find_status.size(); i++) {
+			word(i + offset, 0, {find_status[i], vga_black, vga_gray});
+		}
+	}
+
 	// Print the line and column numbers.
 	std::stringstream status_stream;
-	status_stream << "Ln " << cursor_y + 1 << "/" << rows.size() << ", ";
+	status_stream << "Ln " << cursor_y + 1 << "/" << doc.size();
+	status_stream << (doc.complete() ? ", " : "+, ");
 	status_stream << "Col " << real_cursor_x + 1;
+	if (!carets.empty()) {
+		status_stream << ", " << carets.size() + 1 << " cursors";
+	}
 	std::string status = status_stream.str();
 	for (unsigned int i = 0; i < status.size(); i++) {
 		glyph glyph = {
@@ -604,6 +1461,63 @@ void editor::render() {
 	#endif
 }
 
+// Do background work between frames.
+void editor::idle() {
+	// Add the blocks of the file that have been indexed in the background
+	// for a few milliseconds.
+	Uint32 start = SDL_GetTicks();
+	while (SDL_GetTicks() - start < 8 && doc.extend(false)) {
+		continue;
+	}
+
+	// Carry on highlighting the long rows in view that have been highlighted
+	// before. If the state at the end of a row changes once it is finished,
+	// the row below it is highlighted again. Rows that have not been rendered
+	// yet are left alone, so that the first frame only waits for the rows
+	// in view.
+	for (int i = scroll_y; i < scroll_y + vga_text_mode_y_res; i++) {
+		if (i >= doc.size() || (i >= highlighted && !skips_ahead())) {
+			break;
+		}
+		if (doc.line(i).chunked() && !update(i)) {
+			mark_dirty(i + 1, i + 2);
+		}
+	}
+
+	// Collect the states that the background highlighter has found, and
+	// start it again once the document has been edited (and the edited rows
+	// have been highlighted), or once it has caught up with the states after
+	// the edits. It keeps the states it knows, and starts below them.
+	state_scanner scan = syntax_engines[highlight].scan;
+	if (scan) {
+		background.collect();
+		bool outdated = background.version != version ||
+						background.mode != highlight ||
+						background.stopped_short(doc.size());
+		bool remaining = highlighted < doc.size() || !doc.complete();
+		if (outdated && remaining && dirty_begin >= dirty_end) {
+			background.start(
+				doc,
+				version,
+				highlight,
+				scan,
+				highlighted,
+				upper_state(highlighted)
+			);
+		}
+	}
+
+	// Collect the matches of the search, and search again if the document
+	// has been edited.
+	if (finding) {
+		search.collect();
+		if (searched != version) {
+			find();
+		}
+	}
+}
+
+#ifndef BOSS_NO_MAIN
 // Entry point.
 int main(int argc, char** argv) {
 	// Print the credits (for reference purposes).
@@ -617,71 +1531,27 @@ int main(int argc, char** argv) {
 
 	#ifdef COBALTXII
 	// Create an editor.
-	editor boss = editor(4096 / 32, 2304 / 32 - 8);
+	editor boss(4096 / 32, 2304 / 32 - 8);
 	#else
 	// Create an editor.
-	editor boss = editor(90, 100);
+	editor boss(120, 100);
 	#endif
 
+	// Read the memory cap of the undo history (in megabytes).
+	if (getenv("BOSS_UNDO_LIMIT")) {
+		boss.history.capacity = size_t(atoi(getenv("BOSS_UNDO_LIMIT"))) << 20;
+	}
+
 	// Parse the filename.
 	boss.filename = std::string(argv[1]);
 	// Find the syntax highlighting mode by comparing the end of the
 	// filename to many common file extensions.
-	for (int i = 0; i < sizeof(ext_hm_c) / sizeof(ext_hm_c[0]); i++) {
-		std::string suffix = ext_hm_c[i];
-		if (suffix.size() > boss.filename.size()) {
-			continue;
-		}
-		bool is_match = std::equal(
-			suffix.rbegin(),
-			suffix.rend(),
-			boss.filename.rbegin()
-		);
-		if (is_match) {
-			boss.highlight = hm_c;
-		}
-	}
-	for (int i = 0; i < sizeof(ext_hm_cpp) / sizeof(ext_hm_cpp[0]); i++) {
-		std::string suffix = ext_hm_cpp[i];
-		if (suffix.size() > boss.filename.size()) {
-			continue;
-		}
-		bool is_match = std::equal(
-			suffix.rbegin(),
-			suffix.rend(),
-			boss.filename.rbegin()
-		);
-		if (is_match) {
-			boss.highlight = hm_cpp;
-		}
-	}
+	boss.highlight = find_highlight_mode(boss.filename);
 
 	load_file:
-	// Load a file (or start an empty file).
-	std::ifstream file(argv[1]);
-	// Verify that the file is open.
-	if (file.is_open()) {
-		// Load the file line by line.
-		std::string line;
-		while (std::getline(file, line)) {
-			boss.rows.push_back(row(line));
-			// Calculate the actual length of the line.
-			unsigned int length = 0;
-			for (int i = 0; i < line.length(); i++) {
-				if (line[i] == '\t') {
-					length = (length / 4) * 4 + 4;
-				} else {
-					length++;
-				}
-			}
-			// Resize the window to fit the row.
-			if (length + 10 > boss.vga_text_mode_x_res) {
-				#ifndef COBALTXII
-				boss.vga_text_mode_x_res = length + 10;
-				#endif
-			}
-		}
-	} else {
+	// Open a file (or start an empty file). The file is memory mapped, and
+	// its lines are indexed as they are reached.
+	if (!boss.open(argv[1])) {
 		// Create a new file.
 		std::ofstream file(argv[1]);
 		file << std::endl;
@@ -689,27 +1559,35 @@ int main(int argc, char** argv) {
 		// Load the newly created file.
 		goto load_file;
 	}
-	
+
+	// Index the first screen of the file. The window keeps its width
+	// however long the lines are; the view scrolls horizontally instead.
+	boss.doc.reach(boss.vga_text_mode_y_res);
+
+	#ifdef COBALTXII
+	// The scale of the window.
+	int scale = 2;
+	#else
+	// The scale of the window.
+	int scale = 1;
+	#endif
+
 	// Create a video_interface.
 	video_interface adapter = video_interface(
 		"BOSS",
 		boss.vga_text_mode_x_res * boss.vga_001_x_res,
 		boss.vga_text_mode_y_res * boss.vga_001_y_res,
-		#ifdef COBALTXII
-		2
-		#else
-		1
-		#endif
+		scale
 	);
 
-	// Update all rows.
-	for (unsigned int i = 0; i < boss.rows.size(); i++) {
-		boss.update(i);
-	}
-
 	// Reset the text buffer.
 	boss.render();
 
+	#ifdef ALLOCATION_STATS
+	// Report the allocations made while loading the file.
+	boss.report("Load");
+	#endif
+
 	#ifdef MATRIX_EFFECT
 	// Generate the falling characters.
 	for (int i = 0; i < 128; i++) {
@@ -735,14 +1613,30 @@ int main(int argc, char** argv) {
 			if (e.type == SDL_QUIT) {
 				adapter.quit();
 			} else if (e.type == SDL_KEYDOWN) {
-				boss.key(e);
-				if (e.key.keysym.sym == SDLK_ESCAPE) {
+				// Escape closes the search and removes the extra cursors, and
+				// quits when there are neither.
+				if (e.key.keysym.sym == SDLK_ESCAPE &&
+					boss.carets.empty() &&
+					!boss.finding)
+				{
 					adapter.quit();
 				}
+				boss.key(e);
 			} else if (e.type == SDL_TEXTINPUT) {
 				boss.key(e);
+			} else if (e.type == SDL_MOUSEBUTTONDOWN &&
+					   e.button.button == SDL_BUTTON_LEFT)
+			{
+				// Find the clicked text mode cell.
+				boss.click(
+					e.button.x / (boss.vga_001_x_res * scale),
+					e.button.y / (boss.vga_001_y_res * scale),
+					SDL_GetModState() & KMOD_CTRL
+				);
 			}
 		}
+		// Do background work.
+		boss.idle();
 		// Render the current state to the text buffer.
 		boss.render();
 		// Rasterize the text mode buffer to the video buffer.
@@ -779,4 +1673,5 @@ int main(int argc, char** argv) {
 	}
 	
 	return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
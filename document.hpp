@@ -0,0 +1,887 @@
+// The amount of text that is scanned for newlines at a time while a text
+// buffer is being indexed on the main thread.
+const size_t index_block_size = 1 << 20;
+
+// The amount of text that is scanned for newlines at a time by each thread
+// while a text buffer is being indexed in the background.
+const size_t background_block_size = 1 << 24;
+
+// The smallest capacity of a text buffer that inserted text is appended to.
+const size_t added_block_size = 1 << 20;
+
+// A block of a text buffer that has been scanned for newlines, but has not
+// been added to the line table yet.
+struct index_block {
+	// The range of the text buffer that this block covers.
+	size_t begin;
+	size_t end;
+
+	// The offset of the character following every newline in this block.
+	std::vector<size_t> line_starts;
+
+	// Set once the block has been scanned.
+	bool done;
+
+	// Default constructor.
+	index_block(size_t begin, size_t end): begin(begin), end(end) {
+		done = false;
+	}
+};
+
+// A text buffer. Pieces of a document refer to whole lines of a text buffer,
+// so every text buffer keeps a table of the offsets of its lines. The table
+// is filled in incrementally, so that a huge file can be shown before all of
+// it has been scanned.
+struct text_buffer {
+	// The underlying text. This points either into the storage string, or
+	// into a read-only memory mapping of a file.
+	const char* data = "";
+	size_t length = 0;
+
+	// The owned storage of the underlying text (unused if memory mapped).
+	std::string storage;
+
+	// The memory mapping of the underlying text (NULL if not mapped).
+	void* mapping = NULL;
+
+	// The offset of the first character of every line, followed by a sentinel
+	// entry. Line i spans from line_starts[i] up to (but not including) the
+	// newline at line_starts[i + 1] - 1. If the text does not end with a
+	// newline, the sentinel points one past the end of the text.
+	std::vector<size_t> line_starts = std::vector<size_t>(1, 0);
+
+	// The amount of the underlying text that has been scanned for newlines.
+	size_t indexed = 0;
+
+	// The blocks that are being scanned by background threads, and the index
+	// of the first block that has not been added to the line table yet.
+	std::vector<index_block> blocks;
+	size_t published = 0;
+
+	// The index of the next block that a background thread should scan.
+	std::atomic<size_t> next_block;
+
+	// If set, the background threads stop scanning blocks.
+	std::atomic<bool> stop;
+
+	// The background threads, and the synchronization of finished blocks.
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable scanned;
+
+	// Scan a block for newlines.
+	void scan(index_block& block) {
+		scan_newlines(data, block.begin, block.end, block.line_starts);
+	}
+
+	// Add a scanned block to the line table.
+	void publish(index_block& block) {
+		line_starts.insert(
+			line_starts.end(),
+			block.line_starts.begin(),
+			block.line_starts.end()
+		);
+		indexed = block.end;
+		if (complete() && length > 0 && data[length - 1] != '\n') {
+			// The last line is not terminated by a newline.
+			line_starts.push_back(length + 1);
+		}
+	}
+
+	// Scan blocks on a background thread until there are none left.
+	void work() {
+		for (;;) {
+			size_t i = next_block++;
+			if (i >= blocks.size() || stop) {
+				return;
+			}
+			scan(blocks[i]);
+			std::lock_guard<std::mutex> lock(mutex);
+			blocks[i].done = true;
+			scanned.notify_all();
+		}
+	}
+
+	// Default constructor.
+	text_buffer(): next_block(0), stop(false) {}
+
+	// Destructor.
+	~text_buffer() {
+		release();
+	}
+
+	// Disallow copying.
+	text_buffer(const text_buffer&) = delete;
+	text_buffer& operator=(const text_buffer&) = delete;
+
+	// Get the amount of lines that have been indexed.
+	size_t lines() {
+		return line_starts.size() - 1;
+	}
+
+	// Check if all of the underlying text has been indexed.
+	bool complete() {
+		return indexed == length;
+	}
+
+	// Get a pointer to the first character of a line.
+	const char* line(size_t index) {
+		return data + line_starts[index];
+	}
+
+	// Get the length of a line (excluding the newline).
+	size_t line_length(size_t index) {
+		return line_starts[index + 1] - line_starts[index] - 1;
+	}
+
+	// Scan up to the specified amount of the underlying text for newlines.
+	// A trailing newline does not start another line (as with std::getline).
+	// Returns the amount of lines that were found.
+	size_t index(size_t amount) {
+		size_t before = lines();
+		if (amount > length - indexed) {
+			amount = length - indexed;
+		}
+		index_block block(indexed, indexed + amount);
+		scan(block);
+		publish(block);
+		return lines() - before;
+	}
+
+	// Split the rest of the underlying text into blocks, and scan them on a
+	// pool of background threads. The blocks are added to the line table in
+	// order by advance().
+	void index_in_background() {
+		size_t threads = std::thread::hardware_concurrency();
+		if (threads < 1) {
+			threads = 1;
+		}
+		for (size_t i = indexed; i < length; i += background_block_size) {
+			size_t end = i + background_block_size;
+			if (end > length) {
+				end = length;
+			}
+			blocks.push_back(index_block(i, end));
+		}
+		if (threads > blocks.size()) {
+			threads = blocks.size();
+		}
+		for (size_t i = 0; i < threads; i++) {
+			workers.push_back(std::thread(&text_buffer::work, this));
+		}
+	}
+
+	// Add the next block of lines to the line table. If the text buffer is
+	// being indexed in the background, the next scanned block is added (if
+	// wait is set, this waits until it has been scanned). Otherwise the next
+	// block is scanned right away. Returns false if no block was added.
+	bool advance(bool wait) {
+		if (complete()) {
+			return false;
+		} else if (blocks.empty()) {
+			index(index_block_size);
+			return true;
+		}
+		index_block& block = blocks[published];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!block.done && !wait) {
+				return false;
+			}
+			scanned.wait(lock, [&block] {
+				return block.done;
+			});
+		}
+		publish(block);
+		std::vector<size_t>().swap(block.line_starts);
+		if (++published == blocks.size()) {
+			release_workers();
+		}
+		return true;
+	}
+
+	// Stop and join the background threads, and discard their blocks.
+	void release_workers() {
+		stop = true;
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+		workers.clear();
+		blocks.clear();
+		published = 0;
+		next_block = 0;
+		stop = false;
+	}
+
+	// Discard the underlying text and the line table.
+	void release() {
+		release_workers();
+		#ifndef _WIN32
+		if (mapping) {
+			munmap(mapping, length);
+		}
+		#endif
+		mapping = NULL;
+		storage.clear();
+		data = "";
+		length = 0;
+		line_starts.assign(1, 0);
+		indexed = 0;
+	}
+
+	// Replace the contents of this text buffer with the contents of a file.
+	// The file is memory mapped read-only where possible, and no lines are
+	// indexed yet. Returns false if the file could not be opened.
+	bool map(const char* filename) {
+		release();
+		#ifndef _WIN32
+		int fd = ::open(filename, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			return false;
+		}
+		if (info.st_size > 0) {
+			void* address = mmap(
+				NULL,
+				info.st_size,
+				PROT_READ,
+				MAP_PRIVATE,
+				fd,
+				0
+			);
+			if (address == MAP_FAILED) {
+				close(fd);
+				return false;
+			}
+			mapping = address;
+			data = (const char*)address;
+			length = info.st_size;
+		}
+		close(fd);
+		#else
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		std::stringstream contents;
+		contents << file.rdbuf();
+		storage = contents.str();
+		data = storage.data();
+		length = storage.size();
+		#endif
+		return true;
+	}
+
+	// Replace the contents of this text buffer and index all of the lines.
+	void assign(std::string str) {
+		release();
+		storage.swap(str);
+		data = storage.data();
+		length = storage.size();
+		index(length);
+	}
+
+	// Check if lines can be appended to this text buffer without moving its
+	// underlying text.
+	bool fits(size_t count) {
+		return storage.size() + count + 1 <= storage.capacity();
+	}
+
+	// Append lines to the end of this text buffer. Every appended line is
+	// terminated with a newline. Returns the index of the first appended line.
+	size_t append(const char* str, size_t count) {
+		size_t first = lines();
+		storage.append(str, count);
+		if (count == 0 || str[count - 1] != '\n') {
+			storage += '\n';
+		}
+		data = storage.data();
+		length = storage.size();
+		index(length - indexed);
+		return first;
+	}
+};
+
+// A piece of a document. A piece is either a run of consecutive lines of a
+// text buffer, or a single row that has been materialized for editing. The
+// pieces are kept in a treap ordered by their position in the document, and
+// every node caches the amount of lines in its subtree.
+struct piece_node {
+	// The text buffer this piece refers to (NULL if materialized).
+	text_buffer* buffer;
+
+	// The first line of the text buffer this piece refers to, and the amount
+	// of lines this piece refers to.
+	size_t first;
+	size_t count;
+
+	// The materialized row (NULL if this piece refers to a text buffer).
+	row* line;
+
+	// The amount of lines in this subtree.
+	size_t lines;
+
+	// The treap priority and children of this node.
+	unsigned int priority;
+	piece_node* left;
+	piece_node* right;
+};
+
+// A document. The document is a piece table: the original file and all
+// text that is inserted in bulk live in text buffers, and the document
+// is a balanced tree of pieces that refer to them. A line is materialized as
+// a row when it is accessed, so only the lines that are viewed or edited cost
+// more memory than their text. The lines of the original file are added to
+// the end of the document as they are indexed. Rows and pieces are allocated
+// from the row arena.
+class document {
+private:
+	// The text buffer that holds the original file.
+	text_buffer original;
+	// The append-only text buffers that hold all inserted text. Text is
+	// appended to the last buffer while it fits, and a new buffer is added
+	// once it does not, so inserted text never moves.
+	std::deque<text_buffer> added;
+
+	// The root of the treap of pieces.
+	piece_node* root = NULL;
+
+	// The state of the random number generator for treap priorities.
+	unsigned int seed = 2463534242;
+
+	// Get the next random treap priority (xorshift32).
+	unsigned int random() {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		return seed;
+	}
+
+	// Allocate a node for a piece.
+	piece_node* make_node(text_buffer* buffer,
+						  size_t first,
+						  size_t count,
+						  row* line)
+	{
+		piece_node* node = row_storage->create<piece_node>();
+		node->buffer = buffer;
+		node->first = first;
+		node->count = count;
+		node->line = line;
+		node->lines = count;
+		node->priority = random();
+		node->left = NULL;
+		node->right = NULL;
+		return node;
+	}
+
+	// Get the amount of lines in a subtree.
+	static size_t lines(piece_node* node) {
+		return node ? node->lines : 0;
+	}
+
+	// Recalculate the cached line count of a node.
+	static void pull(piece_node* node) {
+		node->lines = lines(node->left) + node->count + lines(node->right);
+	}
+
+	// Free a subtree.
+	static void destroy(piece_node* node) {
+		if (node) {
+			destroy(node->left);
+			destroy(node->right);
+			row_storage->destroy(node->line);
+			row_storage->destroy(node);
+		}
+	}
+
+	// Merge two subtrees, where every line of a precedes every line of b.
+	static piece_node* merge(piece_node* a, piece_node* b) {
+		if (!a) {
+			return b;
+		} else if (!b) {
+			return a;
+		}
+		if (a->priority > b->priority) {
+			a->right = merge(a->right, b);
+			pull(a);
+			return a;
+		} else {
+			b->left = merge(a, b->left);
+			pull(b);
+			return b;
+		}
+	}
+
+	// Split a subtree so that the first k lines end up in a and the rest end
+	// up in b. A piece that straddles the split point is cut in two.
+	void split(piece_node* node,
+			   size_t k,
+			   piece_node*& a,
+			   piece_node*& b)
+	{
+		if (!node) {
+			a = NULL;
+			b = NULL;
+			return;
+		}
+		size_t left = lines(node->left);
+		if (k <= left) {
+			split(node->left, k, a, node->left);
+			pull(node);
+			b = node;
+		} else if (k >= left + node->count) {
+			split(node->right, k - left - node->count, node->right, b);
+			pull(node);
+			a = node;
+		} else {
+			// Cut the piece in two. Only pieces that refer to a text buffer
+			// can span more than one line.
+			size_t inside = k - left;
+			piece_node* cut = make_node(
+				node->buffer,
+				node->first + inside,
+				node->count - inside,
+				NULL
+			);
+			piece_node* right = node->right;
+			node->count = inside;
+			node->right = NULL;
+			pull(node);
+			a = node;
+			b = merge(cut, right);
+		}
+	}
+
+	// Isolate a single line in its own node, so that the tree is split into
+	// the lines before it, the line itself, and the lines after it.
+	void isolate(size_t index,
+				 piece_node*& before,
+				 piece_node*& line,
+				 piece_node*& after)
+	{
+		piece_node* rest;
+		split(root, index, before, rest);
+		split(rest, 1, line, after);
+		root = NULL;
+	}
+
+	// Write a subtree to an output (anything with a write(data, length)
+	// member). The first flag is cleared once the first line has been
+	// written, so lines are separated by newlines.
+	template <class T>
+	static void write(piece_node* node, T& out, bool& first) {
+		if (!node) {
+			return;
+		}
+		write(node->left, out, first);
+		if (!first) {
+			out.write("\n", 1);
+		}
+		first = false;
+		if (node->line) {
+			node->line->write(out);
+		} else {
+			// Lines are consecutive in their text buffer, so the whole piece
+			// can be written at once.
+			text_buffer* buffer = node->buffer;
+			size_t start = buffer->line_starts[node->first];
+			size_t end = buffer->line_starts[node->first + node->count] - 1;
+			out.write(buffer->data + start, end - start);
+		}
+		write(node->right, out, first);
+	}
+
+	// Call a function with every piece of a subtree that holds lines from a
+	// line on, in order, as f(node, line), where line is the number of the
+	// first line of the piece. Base is the number of the first line of the
+	// subtree.
+	template <class F>
+	static void each_piece(piece_node* node, F& f, size_t from, size_t base) {
+		if (node) {
+			size_t left = lines(node->left);
+			if (from < base + left) {
+				each_piece(node->left, f, from, base);
+			}
+			if (from < base + left + node->count) {
+				f(node, base + left);
+			}
+			each_piece(node->right, f, from, base + left + node->count);
+		}
+	}
+
+public:
+	// Default constructor. A document always contains at least one line.
+	document() {
+		root = make_node(NULL, 0, 1, row_storage->create<row>());
+	}
+
+	// Disallow copying.
+	document(const document&) = delete;
+	document& operator=(const document&) = delete;
+
+	// Destructor.
+	~document() {
+		destroy(root);
+	}
+
+	// Discard all lines of this document at once by releasing the row arena,
+	// instead of freeing them one by one. Nothing else may refer to a row or
+	// piece that was allocated from the row arena anymore.
+	void clear() {
+		row_storage->release();
+		root = make_node(NULL, 0, 1, row_storage->create<row>());
+	}
+
+	// Replace the contents of this document with text.
+	void load(std::string text) {
+		destroy(root);
+		root = NULL;
+		original.assign(text);
+		added.clear();
+		if (original.lines() > 0) {
+			root = make_node(&original, 0, original.lines(), NULL);
+		} else {
+			root = make_node(NULL, 0, 1, row_storage->create<row>());
+		}
+	}
+
+	// Replace the contents of this document with the contents of a file. The
+	// file is mapped into memory and the first block is indexed right away;
+	// the rest is indexed on background threads and added as it is reached.
+	// Returns false if the file could not be opened.
+	bool open(const char* filename) {
+		if (!original.map(filename)) {
+			return false;
+		}
+		destroy(root);
+		root = NULL;
+		added.clear();
+		reach(1);
+		original.index_in_background();
+		if (!root) {
+			root = make_node(NULL, 0, 1, row_storage->create<row>());
+		}
+		return true;
+	}
+
+	// Add the next indexed block of the original file to the end of this
+	// document. If wait is not set, this does not wait for a block that is
+	// still being indexed in the background. Returns false if no block was
+	// added.
+	bool extend(bool wait = true) {
+		size_t first = original.lines();
+		if (!original.advance(wait)) {
+			return false;
+		}
+		size_t count = original.lines() - first;
+		if (count > 0) {
+			root = merge(root, make_node(&original, first, count, NULL));
+		}
+		return true;
+	}
+
+	// Check if all of the original file has been indexed.
+	bool complete() {
+		return original.complete();
+	}
+
+	// Index the original file until this document contains at least the
+	// specified amount of lines (or the whole file has been indexed).
+	void reach(size_t count) {
+		while (size() < count && !complete()) {
+			extend();
+		}
+	}
+
+	// Get the amount of lines in this document that have been indexed.
+	size_t size() {
+		return lines(root);
+	}
+
+	// Get a copy of the text of a line of this document, without
+	// materializing it.
+	std::string text(size_t index) {
+		piece_node* node = root;
+		size_t k = index;
+		while (node) {
+			size_t left = lines(node->left);
+			if (k < left) {
+				node = node->left;
+			} else if (k < left + node->count) {
+				break;
+			} else {
+				k -= left + node->count;
+				node = node->right;
+			}
+		}
+		if (node->line) {
+			return node->line->to_string();
+		}
+		size_t i = node->first + k - lines(node->left);
+		return std::string(
+			node->buffer->line(i),
+			node->buffer->line_length(i)
+		);
+	}
+
+	// Get a line of this document, materializing it as a row if it has not
+	// been accessed before.
+	row& line(size_t index) {
+		piece_node* node = root;
+		size_t k = index;
+		while (node) {
+			size_t left = lines(node->left);
+			if (k < left) {
+				node = node->left;
+			} else if (k < left + node->count) {
+				if (node->line) {
+					return *node->line;
+				}
+				break;
+			} else {
+				k -= left + node->count;
+				node = node->right;
+			}
+		}
+
+		// Materialize the line.
+		piece_node* before;
+		piece_node* after;
+		isolate(index, before, node, after);
+		node->line = row_storage->create<row>(
+			node->buffer->line(node->first),
+			node->buffer->line_length(node->first)
+		);
+		node->buffer = NULL;
+		node->first = 0;
+		root = merge(merge(before, node), after);
+		return *node->line;
+	}
+
+	// Insert a row before the line at the specified index.
+	void insert(size_t index, row line) {
+		piece_node* before;
+		piece_node* after;
+		split(root, index, before, after);
+		piece_node* node = make_node(
+			NULL,
+			0,
+			1,
+			row_storage->create<row>(std::move(line))
+		);
+		root = merge(merge(before, node), after);
+	}
+
+	// Insert newline-separated text as whole lines before the line at the
+	// specified index. The text is appended to the last added buffer (or a
+	// new one, if it does not fit) and inserted as a single piece. Returns
+	// the amount of inserted lines.
+	size_t insert_lines(size_t index, const char* text, size_t length) {
+		if (added.empty() || !added.back().fits(length)) {
+			added.emplace_back();
+			added.back().storage.reserve(
+				std::max(added_block_size, length + 1)
+			);
+		}
+		text_buffer& buffer = added.back();
+		size_t first = buffer.append(text, length);
+		size_t count = buffer.lines() - first;
+		piece_node* before;
+		piece_node* after;
+		split(root, index, before, after);
+		piece_node* node = make_node(&buffer, first, count, NULL);
+		root = merge(merge(before, node), after);
+		return count;
+	}
+
+	// Detach a range of lines from this document, and return them as a
+	// subtree that can be attached again later. Detached lines must be freed
+	// with release().
+	piece_node* detach(size_t index, size_t count) {
+		piece_node* before;
+		piece_node* rest;
+		piece_node* lines;
+		piece_node* after;
+		split(root, index, before, rest);
+		split(rest, count, lines, after);
+		root = merge(before, after);
+		if (!root) {
+			root = make_node(NULL, 0, 1, row_storage->create<row>());
+		}
+		return lines;
+	}
+
+	// Attach a subtree of lines that was detached before the line at the
+	// specified index.
+	void attach(size_t index, piece_node* lines) {
+		piece_node* before;
+		piece_node* after;
+		split(root, index, before, after);
+		root = merge(merge(before, lines), after);
+	}
+
+	// Free a subtree of lines that was detached.
+	static void release(piece_node* lines) {
+		destroy(lines);
+	}
+
+	// Get the amount of lines in a subtree of lines that was detached.
+	static size_t count(piece_node* lines) {
+		return document::lines(lines);
+	}
+
+	// Estimate the amount of memory that a subtree of lines that was detached
+	// holds on to (text in the text buffers is not counted).
+	static size_t footprint(piece_node* node) {
+		if (!node) {
+			return 0;
+		}
+		size_t bytes = sizeof(piece_node);
+		if (node->line) {
+			bytes += sizeof(row) + node->line->size();
+		}
+		return bytes + footprint(node->left) + footprint(node->right);
+	}
+
+	// Write a subtree of lines that was detached to an output (anything with
+	// a write(data, length) member), separated by newlines.
+	template <class T>
+	static void write(piece_node* lines, T& out) {
+		bool first = true;
+		write(lines, out, first);
+	}
+
+	// Erase the line at the specified index.
+	void erase(size_t index) {
+		piece_node* before;
+		piece_node* line;
+		piece_node* after;
+		isolate(index, before, line, after);
+		destroy(line);
+		root = merge(before, after);
+		if (!root) {
+			reach(1);
+		}
+		if (!root) {
+			root = make_node(NULL, 0, 1, row_storage->create<row>());
+		}
+	}
+
+	// Call a function with the text of every piece of this document, in
+	// order, as f(data, begin, end, count, stable). The range from begin up to
+	// end holds count lines, each followed by a newline (except possibly the
+	// last line of the file). Materialized rows are passed as text that is
+	// only valid during the call. Stable text stays valid until the document
+	// is replaced (it is the original file, or inserted text, which never
+	// moves). The part of the original file that has not been
+	// indexed yet is passed last, with a count of zero. Pieces that end before
+	// the specified line are skipped. Returns the number of the first line of
+	// the first piece.
+	template <class F>
+	size_t pieces(F f, size_t from = 0) {
+		std::string text;
+		size_t first = size();
+		auto piece = [&](piece_node* node, size_t line) {
+			first = std::min(first, line);
+			if (node->line) {
+				text = node->line->to_string();
+				text += '\n';
+				f(text.data(), 0, text.size(), 1, false);
+			} else {
+				text_buffer* buffer = node->buffer;
+				size_t begin = buffer->line_starts[node->first];
+				size_t end = std::min(
+					buffer->line_starts[node->first + node->count],
+					buffer->length
+				);
+				f(buffer->data, begin, end, node->count, true);
+			}
+		};
+		each_piece(root, piece, from, 0);
+		if (!original.complete()) {
+			f(
+				original.data,
+				original.line_starts.back(),
+				original.length,
+				0,
+				true
+			);
+		}
+		return first;
+	}
+
+	// Write this document to an output (anything with a write(data, length)
+	// member). Lines are separated by newlines, and no newline is written
+	// after the last line.
+	template <class T>
+	void write(T& out) {
+		while (!complete()) {
+			extend();
+		}
+		bool first = true;
+		write(root, out, first);
+	}
+};
+
+// A piece of a snapshot of a document.
+struct snapshot_piece {
+	// The text of this piece spans from begin up to (but not including) end.
+	const char* data;
+	size_t begin;
+	size_t end;
+
+	// The line number of the first line of this piece.
+	size_t line;
+};
+
+// A snapshot of the text of a document, that worker threads can read while
+// the document is edited. Materialized rows are copied into the snapshot;
+// the original file and inserted text are not.
+struct document_snapshot {
+	// The pieces of the snapshot, and the copied text.
+	std::vector<snapshot_piece> pieces;
+	std::string copies;
+
+	// Take a snapshot of a document, from the piece that holds a line on.
+	void take(document& doc, size_t from = 0) {
+		clear();
+		size_t line = 0;
+		size_t first = doc.pieces([&](const char* data,
+									  size_t begin,
+									  size_t end,
+									  size_t count,
+									  bool stable)
+		{
+			if (stable) {
+				pieces.push_back({data, begin, end, line});
+			} else if (!pieces.empty() && !pieces.back().data) {
+				// Copy the text, after the previous copied piece.
+				copies.append(data + begin, end - begin);
+				pieces.back().end = copies.size();
+			} else {
+				// Copy the text into a new piece.
+				pieces.push_back({NULL, copies.size(), copies.size(), line});
+				copies.append(data + begin, end - begin);
+				pieces.back().end = copies.size();
+			}
+			line += count;
+		}, from);
+		for (size_t i = 0; i < pieces.size(); i++) {
+			if (!pieces[i].data) {
+				pieces[i].data = copies.data();
+			}
+			pieces[i].line += first;
+		}
+	}
+
+	// Discard the snapshot.
+	void clear() {
+		pieces.clear();
+		copies.clear();
+	}
+};
\ No newline at end of file
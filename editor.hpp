@@ -1,3 +1,9 @@
+// The position of a cursor.
+struct caret {
+	int x;
+	int y;
+};
+
 // A BOSS editor.
 struct editor {
 	// VGA text mode dimensions.
@@ -13,11 +19,47 @@ struct editor {
 	// VGA text mode buffer.
 	glyph* text = NULL;
 
+	// The VGA text mode buffer as it was last rasterized. Only the cells that
+	// differ from it are rasterized again.
+	glyph* shown = NULL;
+
 	// The current syntax highlighting mode.
 	highlight_mode highlight = hm_null;
 
-	// All of the rows currently present in the editor.
-	std::vector<row> rows;
+	// The arena that rows are allocated from. It is declared before the
+	// document, so that it outlives the rows of the document. Rows find it
+	// through row_storage, so only one editor can exist at a time.
+	arena storage{row_storage};
+
+	// The document currently present in the editor.
+	document doc;
+
+	// The amount of leading rows that have been syntax highlighted. Rows are
+	// highlighted on demand as they come into view.
+	int highlighted = 0;
+
+	// The range of highlighted rows that have to be highlighted again, because
+	// they were edited or the state at the end of the row above them changed.
+	int dirty_begin = 0;
+	int dirty_end = 0;
+
+	#ifdef ALLOCATION_STATS
+	// The amount of rows (and chunks of long rows) that have been highlighted,
+	// and the amount of heap and arena blocks that were allocated while they
+	// were. Highlighting a row again reuses its color spans, and the lexer
+	// only returns extents of the row, so a row that is highlighted again
+	// allocates nothing unless it has more spans than ever before.
+	size_t lexed_rows = 0;
+	size_t lexed_heap_allocations = 0;
+	size_t lexed_arena_allocations = 0;
+
+	// If set, the allocation counts are reported after every edit.
+	bool report_edits = true;
+	#endif
+
+	// The background highlighter, which finds the lexer states of the rows
+	// below the highlighted rows.
+	highlighter background;
 
 	// The scrolling offsets.
 	int scroll_x = 0;
@@ -27,6 +69,10 @@ struct editor {
 	int cursor_x = 0;
 	int cursor_y = 0;
 
+	// The positions of the extra cursors, in the order they were added. Edits
+	// are made at every cursor at once.
+	std::vector<caret> carets;
+
 	// The "motion tick". This is the timestamp of the last cursor movement (in
 	// milliseconds since the start of the editor). The "motion tick" value is
 	// used to prevent blinking while the cursor is in motion.
@@ -35,6 +81,43 @@ struct editor {
 	// The currently opened file's filename.
 	std::string filename;
 
+	// The undo/redo journal.
+	journal history;
+
+	// The amount of edits that have been made to the document.
+	size_t version = 0;
+
+	// If the search is open, the 'finding' flag will be set. The search runs
+	// over a snapshot of the document, taken at the specified version, and
+	// the first row that has been edited since then.
+	bool finding = false;
+	std::string query;
+	searcher search;
+	size_t searched = -1;
+	size_t search_edit = -1;
+
+	// If the query is a regular expression, the 'regex_mode' flag will be
+	// set. The compiled query highlights the matches in view.
+	bool regex_mode = false;
+	regex pattern;
+
+	// The text of a row in view that is searched while rendering, and the
+	// matches in it. They are reused for every row.
+	std::string row_text;
+	std::vector<size_t> row_matches;
+
+	// If the replacement is being typed, the 'replacing' flag will be set.
+	bool replacing = false;
+	std::string replacement;
+
+	// The writer that saves the file (its write buffer is reused).
+	file_writer writer;
+
+	// A message shown in the status bar, and the timestamp at which it was
+	// shown (in milliseconds since the start of the editor).
+	std::string message;
+	Uint32 message_tick = 0;
+
 	// If CTRL-B is hit, the video buffer will be saved after all events are
 	// polled. The key handler will set this flag to true.
 	bool save_video = false;
@@ -56,6 +139,16 @@ struct editor {
 		}
 	}
 
+	// Call a function with the position of every cursor (the cursor first,
+	// then the extra cursors). The positions are passed by reference.
+	template <class F>
+	void each_cursor(F f) {
+		f(cursor_x, cursor_y);
+		for (size_t i = 0; i < carets.size(); i++) {
+			f(carets[i].x, carets[i].y);
+		}
+	}
+
 	// Default constructor.
 	editor(int text_mode_x_res,
 		   int text_mode_y_res)
@@ -65,23 +158,108 @@ struct editor {
 		vga_text_mode_y_res = text_mode_y_res;
 
 		// Allocate the text buffer.
-		text = (glyph*)malloc(
-			vga_text_mode_x_res *
-			vga_text_mode_y_res *
-			sizeof(glyph)
-		);
+		allocate_text();
+	}
 
-		if (!text) {
+	// Destructor.
+	~editor() {
+		free(text);
+		free(shown);
+	}
+
+	// Disallow copying.
+	editor(const editor&) = delete;
+	editor& operator=(const editor&) = delete;
+
+	// Allocate the text buffer (again), and the buffer of the cells as they
+	// were last rasterized. The cells are marked as never rasterized, so that
+	// all of them are rasterized next.
+	void allocate_text() {
+		size_t cells = vga_text_mode_x_res * vga_text_mode_y_res;
+		free(text);
+		free(shown);
+		text = (glyph*)malloc(cells * sizeof(glyph));
+		shown = (glyph*)malloc(cells * sizeof(glyph));
+
+		if (!text || !shown) {
 			barf("Could not allocate text memory.");
 		}
+
+		for (size_t i = 0; i < cells; i++) {
+			forget(shown[i]);
+		}
+	}
+
+	// Mark a rasterized cell as never rasterized. No glyph has this color.
+	static void forget(glyph& cell) {
+		cell.fg = 0xff;
 	}
 
+	// Close the current document and open a file.
+	bool open(const char* filename);
+	// Report the allocation counts of the row arena.
+	void report(const char* when);
 	// Rasterize the text buffer to the video buffer of a video_interface*.
 	void raster(video_interface* vga);
-	// Update a row.
-	void update(int row_index);
+	// Find the lexer state at the start of a row.
+	int upper_state(int row_index);
+	// Update a row. Returns false if it was highlighted again.
+	bool update(int row_index);
+	// Highlight the rows that need it, up to the bottom of the view.
+	void highlight_view();
+	// Check if the rows in view are highlighted apart from the rows above.
+	bool skips_ahead();
+	// Mark a range of rows as needing to be highlighted again.
+	void mark_dirty(int begin, int end);
+	// Mark an edited row as needing to be highlighted again, after inserting
+	// (or removing, if negative) an amount of rows below it.
+	void invalidate(int row_index, int lines = 0);
+	// Edit primitives. Every edit is recorded in the journal.
+	void insert_text(int line, int column, const char* text, size_t length);
+	void erase_text(int line, int column, size_t length);
+	void split_line(int line, int column);
+	void join_line(int line);
+	int insert_lines(int line, const char* text, size_t length);
+	void erase_lines(int line, int count);
+	// Paste text at a position.
+	void splice(int line, int column, const char* text, size_t length);
+	// Move every cursor along with an edit, so that it stays on the same text.
+	void follow(edit_kind kind, int line, int column, int count);
+	// Clamp the extra cursors to the document, and merge cursors that are at
+	// the same position.
+	void merge_cursors();
+	// Add an extra cursor.
+	void add_cursor(int x, int y);
+	// Add an extra cursor at the next occurrence of the word at the newest
+	// cursor.
+	void add_next_occurrence();
+	// Convert between character indices and display columns of a row.
+	int display_x(int x, int y);
+	int character_x(int display_x, int y);
+	// Scroll horizontally so that the cursor is in view.
+	void reveal();
+	// Move a cursor with an arrow key.
+	void move(int& x, int& y, SDL_Keycode key);
+	// Mouse click handler. The position is in text mode cells.
+	void click(int x, int y, bool add);
+	// Apply or revert an edit that was recorded in the journal.
+	void apply(edit& e, bool revert);
+	// Undo the last transaction.
+	void undo();
+	// Redo the last undone transaction.
+	void redo();
+	// Search the document for the query.
+	void find();
+	// Move the cursor to the next match of the search.
+	void find_next();
+	// Replace every match of the search in the document.
+	void replace_all();
+	// Keypress handler while searching.
+	bool find_key(SDL_Event e);
 	// Keypress handler.
 	void key(SDL_Event e);
 	// Render the current state to the text buffer.
 	void render();
+	// Do background work between frames.
+	void idle();
 };
\ No newline at end of file
@@ -0,0 +1,483 @@
+// The amount of text that the highlighting threads scan at a time. Blocks end
+// at the end of a line, so a block may be longer (by up to a line).
+const size_t highlight_block_size = 1 << 20;
+
+// A block of the snapshot of a background highlighter, which is a run of
+// whole lines of one piece.
+struct highlight_block {
+	// The piece, and the range of it that this block covers.
+	size_t piece;
+	size_t begin;
+	size_t end;
+
+	// The state at the end of every line of this block.
+	std::vector<unsigned char> states;
+
+	// Set once the block has been scanned.
+	bool done;
+
+	// Default constructor.
+	highlight_block(size_t piece, size_t begin, size_t end):
+		piece(piece), begin(begin), end(end)
+	{
+		done = false;
+	}
+};
+
+// A background highlighter. It runs over a snapshot of the document from a
+// line on, and finds the lexer state at the end of every line after it, so
+// that rows far below the highlighted rows can be highlighted without
+// highlighting every row above them first. The states are reported in
+// batches. Edits move the states along with the lines, and only the states
+// above the first edited line stay known; the next scan starts there, and
+// ends at the first line below the edits that ends in the same state as
+// before, since the states below it have not changed.
+//
+// The snapshot is split into blocks, which a pool of threads scans at the
+// same time. Every block but the first is scanned as if no multiline comment
+// were open at its start. The worker then goes over the blocks in order and
+// scans a block again if a comment turns out to be open at its start, up to
+// the first line whose state does not change, before it reports the states
+// of the block.
+class highlighter {
+private:
+	// The snapshot of the document, the function that scans its lines, the
+	// line the scan starts at, and the state at the start of it.
+	document_snapshot source;
+	state_scanner scan = NULL;
+	size_t from = 0;
+	int entry = 0;
+
+	// The states from the known states up to the end of the edited lines are
+	// out of date, and the ones after them are as they were before the edits.
+	// The worker compares its states with a copy of the latter, which starts
+	// at the line a stale amount of lines after the one it starts at.
+	size_t stale_end = 0;
+	std::vector<unsigned char> previous;
+	size_t stale = 0;
+
+	// The blocks of the snapshot, and the index of the next block that a
+	// thread of the pool should scan.
+	std::vector<highlight_block> blocks;
+	std::atomic<size_t> next_block;
+
+	// The states the worker has found that have not been collected, whether
+	// they end where the states after them are as before, and whether the
+	// worker has finished.
+	std::vector<unsigned char> found;
+	bool converged = false;
+	std::atomic<bool> finished;
+
+	// The worker, the pool of threads that scan the blocks, and the
+	// synchronization of their results.
+	std::thread worker;
+	std::vector<std::thread> pool;
+	std::atomic<bool> stop;
+	std::mutex mutex;
+	std::condition_variable scanned;
+
+	// Scan the lines of a block from a state, and call a function with the
+	// state at the end of each line, as f(index, state), where index is the
+	// index of the line in the block. The scan ends early if the function
+	// returns false, or if the worker is stopped (in which case this returns
+	// false).
+	template <class F>
+	bool scan_lines(highlight_block& block, int state, F f) {
+		snapshot_piece& piece = source.pieces[block.piece];
+		size_t offset = block.begin;
+		for (size_t i = 0; offset < block.end; i++) {
+			const char* text = piece.data + offset;
+			const char* newline = (const char*)memchr(
+				text,
+				'\n',
+				block.end - offset
+			);
+			size_t length = newline ? newline - text : block.end - offset;
+
+			// Long lines are scanned in chunks like the rows they become, so
+			// that the worker can be stopped in the middle of them. Only an
+			// open multiline comment carries over to the next line, and empty
+			// lines keep the state of the line above them.
+			int end = state;
+			size_t count;
+			for (size_t j = 0; j < length && !stop; j += count) {
+				count = length > row_long_size ?
+						chunk_length(text + j, length - j) :
+						length;
+				end = scan(text + j, count, end, j > 0);
+			}
+			if (stop) {
+				return false;
+			}
+			if (length > 0) {
+				state = end & ls_open;
+			}
+			if (!f(i, state)) {
+				return true;
+			}
+			offset += length + (newline ? 1 : 0);
+		}
+		return true;
+	}
+
+	// Scan blocks on a thread of the pool until there are none left. Every
+	// block but the first is scanned from the state outside of comments.
+	void scan_blocks() {
+		for (;;) {
+			size_t i = next_block++;
+			if (i >= blocks.size() || stop) {
+				return;
+			}
+			highlight_block& block = blocks[i];
+			bool scanned_all = scan_lines(
+				block,
+				i == 0 ? entry : 0,
+				[&block](size_t, int state) {
+					block.states.push_back(state);
+					return true;
+				}
+			);
+			if (!scanned_all) {
+				return;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			block.done = true;
+			scanned.notify_all();
+		}
+	}
+
+	// Check if a line, by its index from the line the worker starts at, is
+	// below the edits and ends in the same state as before.
+	bool unchanged(size_t line, int state) const {
+		return line >= stale &&
+			   line - stale < previous.size() &&
+			   previous[line - stale] == state;
+	}
+
+	// Report the states of a block, up to and including a line where the
+	// states after it are as before if there is one.
+	void report(highlight_block& block, size_t line, bool& done) {
+		size_t count = block.states.size();
+		for (size_t k = 0; k < count && !done; k++) {
+			if (unchanged(line + k, block.states[k])) {
+				count = k + 1;
+				done = true;
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		found.insert(
+			found.end(),
+			block.states.begin(),
+			block.states.begin() + count
+		);
+		converged = done;
+		std::vector<unsigned char>().swap(block.states);
+	}
+
+	// Split the snapshot into blocks, skipping the lines before the line to
+	// start at, and scan them on a pool of threads. The blocks are checked and
+	// reported in order.
+	void work() {
+		// Find the start of the first line.
+		size_t line = source.pieces.empty() ? from : source.pieces[0].line;
+		size_t skip = 0;
+		while (!source.pieces.empty() && line < from) {
+			snapshot_piece& piece = source.pieces[0];
+			const char* newline = (const char*)memchr(
+				piece.data + piece.begin + skip,
+				'\n',
+				piece.end - piece.begin - skip
+			);
+			if (!newline) {
+				break;
+			}
+			skip = newline - piece.data - piece.begin + 1;
+			line++;
+		}
+
+		// Split the pieces into blocks that end at the end of a line.
+		for (size_t p = 0; p < source.pieces.size(); p++) {
+			snapshot_piece& piece = source.pieces[p];
+			size_t begin = piece.begin + (p == 0 ? skip : 0);
+			while (begin < piece.end) {
+				size_t end = piece.end;
+				if (piece.end - begin > highlight_block_size) {
+					const char* newline = (const char*)memchr(
+						piece.data + begin + highlight_block_size,
+						'\n',
+						piece.end - begin - highlight_block_size
+					);
+					end = newline ? newline - piece.data + 1 : piece.end;
+				}
+				blocks.push_back(highlight_block(p, begin, end));
+				begin = end;
+			}
+		}
+
+		// After edits, the first block is scanned on its own, since the scan
+		// usually ends a few lines below the edits.
+		int state = entry;
+		size_t reported = 0;
+		size_t begin = 0;
+		bool done = false;
+		if (!previous.empty() && !blocks.empty()) {
+			highlight_block& block = blocks[0];
+			bool scanned_all = scan_lines(
+				block,
+				entry,
+				[&block, this](size_t k, int now) {
+					block.states.push_back(now);
+					return !unchanged(k, now);
+				}
+			);
+			if (!block.states.empty()) {
+				state = block.states.back();
+			}
+			reported = block.states.size();
+			if (scanned_all) {
+				report(block, 0, done);
+			}
+			done = done || !scanned_all;
+			begin = 1;
+			next_block = 1;
+		}
+
+		// Scan the other blocks on a pool of threads.
+		size_t threads = std::thread::hardware_concurrency();
+		if (threads < 1) {
+			threads = 1;
+		}
+		if (done || threads > blocks.size() - begin) {
+			threads = done ? 0 : blocks.size() - begin;
+		}
+		for (size_t i = 0; i < threads; i++) {
+			pool.push_back(std::thread(&highlighter::scan_blocks, this));
+		}
+
+		// Go over the blocks in order. A block that was scanned from the
+		// wrong state is scanned again from the state at the end of the
+		// block before it, until a line ends in the same state as before;
+		// the lines after it are up to date.
+		for (size_t i = begin; i < blocks.size() && !done; i++) {
+			highlight_block& block = blocks[i];
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				scanned.wait(lock, [&block, this] {
+					return block.done || stop;
+				});
+				if (stop) {
+					break;
+				}
+			}
+			if (i > 0 && state != 0) {
+				bool scanned_all = scan_lines(
+					block,
+					state,
+					[&block](size_t k, int now) {
+						if (block.states[k] == now) {
+							return false;
+						}
+						block.states[k] = now;
+						return true;
+					}
+				);
+				if (!scanned_all) {
+					break;
+				}
+			}
+			if (!block.states.empty()) {
+				state = block.states.back();
+			}
+			size_t count = block.states.size();
+			report(block, reported, done);
+			reported += count;
+		}
+
+		// Stop and join the pool.
+		bool stopped = stop;
+		stop = true;
+		for (size_t i = 0; i < pool.size(); i++) {
+			pool[i].join();
+		}
+		pool.clear();
+		blocks.clear();
+		next_block = 0;
+		finished = !stopped;
+	}
+
+	// Stop and join the worker.
+	void halt() {
+		if (worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+				scanned.notify_all();
+			}
+			worker.join();
+			stop = false;
+		}
+		collect();
+	}
+
+public:
+	// The version of the document the snapshot was taken at, and the
+	// syntax highlighting mode it is scanned with.
+	size_t version = -1;
+	highlight_mode mode = hm_null;
+
+	// The first line that is scanned, the states at the end of the lines from
+	// there on that have been collected, and the amount of them that are
+	// known to be up to date.
+	size_t first = 0;
+	std::vector<unsigned char> states;
+	size_t known = 0;
+
+	// Default constructor.
+	highlighter(): next_block(0), finished(false), stop(false) {}
+
+	// Destructor.
+	~highlighter() {
+		halt();
+	}
+
+	// Disallow copying.
+	highlighter(const highlighter&) = delete;
+	highlighter& operator=(const highlighter&) = delete;
+
+	// Take a snapshot of a document at a version, and start finding the
+	// states at the end of its lines with a syntax highlighting mode, from a
+	// line on, where the state at the start of the line is given. The states
+	// that are known are kept, and the scan starts below them.
+	void start(document& doc,
+			   size_t at,
+			   highlight_mode with,
+			   state_scanner scanner,
+			   size_t line,
+			   int state)
+	{
+		halt();
+
+		// Move the first line to the line, keeping the states after it.
+		if (with != mode) {
+			states.clear();
+			known = 0;
+			stale_end = 0;
+		} else if (line > first) {
+			size_t count = std::min(line - first, states.size());
+			states.erase(states.begin(), states.begin() + count);
+			known -= std::min(known, line - first);
+			stale_end -= std::min(stale_end, line - first);
+		} else if (line < first) {
+			states.insert(states.begin(), first - line, 0);
+			stale_end = (stale_end > known ? stale_end : 0) + first - line;
+			known = 0;
+		}
+		first = line;
+
+		// Start from the first state that is not known, and compare with the
+		// states after the edits.
+		from = first + known;
+		entry = known > 0 ? states[known - 1] : state;
+		stale = stale_end - known;
+		previous.assign(
+			states.begin() + std::min(stale_end, states.size()),
+			states.end()
+		);
+		source.take(doc, from);
+		version = at;
+		mode = with;
+		scan = scanner;
+		finished = false;
+		worker = std::thread(&highlighter::work, this);
+	}
+
+	// Move the states along with an edit of a line, where lines is the amount
+	// of lines that were inserted below it, or removed below it if negative.
+	// The states from the line on are no longer known.
+	void edit(size_t line, ptrdiff_t lines) {
+		halt();
+		if (line < first) {
+			// The lines above the first line only move it, but the state at
+			// the start of it may have changed.
+			size_t removed = line - lines + 1;
+			size_t count = removed > first ? removed - first : 0;
+			count = std::min(count, states.size());
+			states.erase(states.begin(), states.begin() + count);
+			first = std::max<ptrdiff_t>(first + lines, line + 1);
+			known = 0;
+			stale_end = 0;
+			return;
+		}
+		size_t index = line - first;
+		if (index >= states.size()) {
+			return;
+		}
+		if (lines > 0) {
+			states.insert(states.begin() + index + 1, lines, 0);
+		} else {
+			size_t count = std::min<size_t>(-lines, states.size() - index - 1);
+			states.erase(
+				states.begin() + index + 1,
+				states.begin() + index + 1 + count
+			);
+		}
+		if (stale_end <= known) {
+			stale_end = 0;
+		}
+		if (stale_end > index) {
+			stale_end = std::max<ptrdiff_t>(stale_end + lines, index + 1);
+		}
+		stale_end = std::max<size_t>(
+			stale_end,
+			index + 1 + std::max<ptrdiff_t>(lines, 0)
+		);
+		known = std::min(known, index);
+	}
+
+	// Discard the snapshot and the states.
+	void cancel() {
+		halt();
+		source.clear();
+		states.clear();
+		known = 0;
+		stale_end = 0;
+		version = -1;
+		mode = hm_null;
+	}
+
+	// Collect the states that the worker has reported. Once the worker gets
+	// to a line that ends in the same state as before the edits, the states
+	// after it are known again.
+	void collect() {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < found.size(); i++, known++) {
+			if (known < states.size()) {
+				states[known] = found[i];
+			} else {
+				states.push_back(found[i]);
+			}
+		}
+		found.clear();
+		if (converged) {
+			known = states.size();
+			converged = false;
+		}
+		stale_end = std::max(stale_end, known);
+	}
+
+	// Check if the worker has finished short of a line, which happens when it
+	// gets to the states after the edits before the old scan got there.
+	bool stopped_short(size_t line) {
+		return finished && first + known < line;
+	}
+
+	// Get the known state at the end of a line. Returns false if the state is
+	// unknown.
+	bool state(size_t line, int& out) {
+		if (line < first || line - first >= known) {
+			return false;
+		}
+		out = states[line - first];
+		return true;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,340 @@
+// All kinds of edits.
+enum edit_kind {
+	ed_insert_text,
+	ed_erase_text,
+	ed_split_line,
+	ed_join_line,
+	ed_insert_lines,
+	ed_erase_lines
+};
+
+// An edit of the document. Every edit can be applied (redo) and reverted
+// (undo) by the editor.
+struct edit {
+	edit_kind kind;
+
+	// The row and column the edit applies to. For line edits, the column is
+	// unused; for joins, the column is the length of the upper row before
+	// the rows were joined.
+	int line;
+	int column;
+
+	// The text that was inserted or erased (text edits), or the amount of
+	// lines that were inserted or erased (line edits).
+	std::string text;
+	size_t count;
+
+	// Lines that are detached from the document and owned by this edit (the
+	// erased lines of an applied ed_erase_lines, or the inserted lines of a
+	// reverted ed_insert_lines), or NULL.
+	piece_node* lines;
+
+	// If the payload of this edit (its text or detached lines) was spilled to
+	// the spill file, this flag will be set, and the offset and length of the
+	// payload in the spill file are stored.
+	bool spilled;
+	long spill_offset;
+	size_t spill_length;
+
+	// Default constructor.
+	edit(edit_kind kind,
+		 int line,
+		 int column,
+		 std::string text = "",
+		 size_t count = 0)
+	{
+		this->kind = kind;
+		this->line = line;
+		this->column = column;
+		this->text = text;
+		this->count = count;
+		lines = NULL;
+		spilled = false;
+		spill_offset = 0;
+		spill_length = 0;
+	}
+};
+
+// All kinds of transactions. Consecutive transactions of the same kind are
+// coalesced into one when the cursor has not moved in between.
+enum transaction_kind {
+	tr_other,
+	tr_typing,
+	tr_erasing
+};
+
+// A group of edits that is undone and redone at once.
+struct transaction {
+	transaction_kind kind;
+
+	// The edits, in the order they were applied.
+	std::vector<edit> edits;
+
+	// The cursor position before and after the transaction.
+	int cursor_x_before;
+	int cursor_y_before;
+	int cursor_x_after;
+	int cursor_y_after;
+
+	// The amount of memory the payloads of the edits hold on to.
+	size_t bytes;
+};
+
+// An undo/redo journal. The journal records edits rather than snapshots of
+// the document: text edits keep the affected text, and line edits keep the
+// affected lines as a detached subtree of the document, so undoing a paste of
+// any size is a single tree operation. Once the payloads of the undo history
+// exceed the memory cap, the oldest payloads are spilled to a temporary file,
+// and once the spill file exceeds its own cap, the oldest transactions are
+// dropped.
+class journal {
+private:
+	// The temporary file that payloads are spilled to (NULL until needed).
+	FILE* spill = NULL;
+	// The size of the spill file.
+	size_t spill_size = 0;
+
+	// The index of the oldest transaction that has not been spilled.
+	size_t unspilled = 0;
+
+	// Set while a transaction is being recorded.
+	bool recording = false;
+
+	// Estimate the amount of memory an edit holds on to.
+	static size_t measure(edit& e) {
+		return sizeof(edit) + e.text.capacity() + document::footprint(e.lines);
+	}
+
+	// Free the detached lines of an edit.
+	static void release(edit& e) {
+		document::release(e.lines);
+		e.lines = NULL;
+	}
+
+	// Free all transactions of a stack.
+	static void release(std::vector<transaction>& stack) {
+		for (size_t i = 0; i < stack.size(); i++) {
+			for (size_t j = 0; j < stack[i].edits.size(); j++) {
+				release(stack[i].edits[j]);
+			}
+		}
+		stack.clear();
+	}
+
+	// Spill the payloads of a transaction to the spill file.
+	void spill_transaction(transaction& t) {
+		if (!spill) {
+			spill = tmpfile();
+			if (!spill) {
+				return;
+			}
+		}
+		for (size_t i = 0; i < t.edits.size(); i++) {
+			edit& e = t.edits[i];
+			if (e.spilled || (e.text.empty() && !e.lines)) {
+				continue;
+			}
+			std::string payload;
+			if (e.lines) {
+				// Every line ends with a newline, so that an empty last line
+				// is inserted again too.
+				std::stringstream lines;
+				document::write(e.lines, lines);
+				lines << '\n';
+				payload = lines.str();
+				release(e);
+			} else {
+				payload.swap(e.text);
+			}
+			fseek(spill, 0, SEEK_END);
+			e.spill_offset = spill_size;
+			e.spill_length = payload.size();
+			e.spilled = true;
+			fwrite(payload.data(), 1, payload.size(), spill);
+			spill_size += payload.size();
+		}
+		bytes -= t.bytes;
+		t.bytes = 0;
+		for (size_t i = 0; i < t.edits.size(); i++) {
+			t.bytes += measure(t.edits[i]);
+		}
+		bytes += t.bytes;
+	}
+
+	// Enforce the memory cap on the undo history. The oldest transactions are
+	// spilled first, and dropped if the history (or the spill file) is still
+	// too big.
+	void enforce() {
+		while (bytes > capacity && unspilled + 1 < past.size()) {
+			spill_transaction(past[unspilled++]);
+		}
+		while ((bytes > capacity || spill_size > capacity * 8) &&
+			   past.size() > 1)
+		{
+			bytes -= past[0].bytes;
+			for (size_t i = 0; i < past[0].edits.size(); i++) {
+				release(past[0].edits[i]);
+			}
+			past.erase(past.begin());
+			if (unspilled > 0) {
+				unspilled--;
+			}
+			if (unspilled == 0 && spill) {
+				// Nothing that is left refers to the spill file.
+				fclose(spill);
+				spill = NULL;
+				spill_size = 0;
+			}
+		}
+	}
+
+public:
+	// The memory cap of the undo history (in bytes).
+	size_t capacity = 64 << 20;
+
+	// The amount of memory the undo history holds on to.
+	size_t bytes = 0;
+
+	// The undo and redo stacks.
+	std::vector<transaction> past;
+	std::vector<transaction> future;
+
+	// Default constructor.
+	journal() {}
+
+	// Destructor.
+	~journal() {
+		clear();
+	}
+
+	// Disallow copying.
+	journal(const journal&) = delete;
+	journal& operator=(const journal&) = delete;
+
+	// Start recording a transaction. If the last transaction is of the same
+	// kind (and not tr_other), and the cursor is where that transaction left
+	// it, the new edits are added to it instead.
+	void begin(transaction_kind kind, int cursor_x, int cursor_y) {
+		recording = true;
+		if (kind != tr_other && !past.empty() && unspilled < past.size()) {
+			transaction& last = past.back();
+			if (last.kind == kind &&
+				last.cursor_x_after == cursor_x &&
+				last.cursor_y_after == cursor_y)
+			{
+				return;
+			}
+		}
+		transaction t;
+		t.kind = kind;
+		t.cursor_x_before = cursor_x;
+		t.cursor_y_before = cursor_y;
+		t.cursor_x_after = cursor_x;
+		t.cursor_y_after = cursor_y;
+		t.bytes = 0;
+		past.push_back(t);
+	}
+
+	// Record an edit that was applied to the document. Adjacent typed or
+	// erased text is merged into the previous edit.
+	void record(edit e) {
+		release(future);
+		transaction& t = past.back();
+		edit* last = t.edits.empty() ? NULL : &t.edits.back();
+		bytes -= t.bytes;
+		if (last && last->kind == e.kind && last->line == e.line &&
+			e.kind == ed_insert_text &&
+			last->column + int(last->text.size()) == e.column)
+		{
+			t.bytes -= measure(*last);
+			last->text += e.text;
+			t.bytes += measure(*last);
+		} else if (last && last->kind == e.kind && last->line == e.line &&
+				   e.kind == ed_erase_text &&
+				   e.column + int(e.text.size()) == last->column)
+		{
+			t.bytes -= measure(*last);
+			last->text.insert(0, e.text);
+			last->column = e.column;
+			t.bytes += measure(*last);
+		} else {
+			t.edits.push_back(e);
+			t.bytes += measure(t.edits.back());
+		}
+		bytes += t.bytes;
+	}
+
+	// Finish recording a transaction. Empty transactions are discarded.
+	// Returns true if any edits were recorded.
+	bool finish(int cursor_x, int cursor_y) {
+		if (!recording) {
+			return false;
+		}
+		recording = false;
+		if (past.back().edits.empty()) {
+			past.pop_back();
+			return false;
+		}
+		past.back().cursor_x_after = cursor_x;
+		past.back().cursor_y_after = cursor_y;
+		enforce();
+		return true;
+	}
+
+	// Discard the undo and redo history.
+	void clear() {
+		release(past);
+		release(future);
+		if (spill) {
+			fclose(spill);
+			spill = NULL;
+		}
+		spill_size = 0;
+		unspilled = 0;
+		bytes = 0;
+	}
+
+	// Load the payload of an edit back from the spill file. Spilled lines are
+	// loaded back as text.
+	void restore(edit& e) {
+		if (!e.spilled) {
+			return;
+		}
+		e.text.resize(e.spill_length);
+		fseek(spill, e.spill_offset, SEEK_SET);
+		if (fread(&e.text[0], 1, e.spill_length, spill) != e.spill_length) {
+			barf("Could not read the undo history.");
+		}
+		e.spilled = false;
+	}
+
+	// Pop the last transaction from a stack so that it can be undone or
+	// redone. The payloads of the transaction are restored.
+	transaction pop(std::vector<transaction>& stack) {
+		transaction t = std::move(stack.back());
+		stack.pop_back();
+		if (&stack == &past) {
+			bytes -= t.bytes;
+			if (unspilled > past.size()) {
+				unspilled = past.size();
+			}
+		}
+		for (size_t i = 0; i < t.edits.size(); i++) {
+			restore(t.edits[i]);
+		}
+		return t;
+	}
+
+	// Push a transaction that was undone or redone onto a stack.
+	void push(std::vector<transaction>& stack, transaction t) {
+		t.bytes = 0;
+		for (size_t i = 0; i < t.edits.size(); i++) {
+			t.bytes += measure(t.edits[i]);
+		}
+		stack.push_back(std::move(t));
+		if (&stack == &past) {
+			bytes += stack.back().bytes;
+			enforce();
+		}
+	}
+};
\ No newline at end of file
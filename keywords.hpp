@@ -0,0 +1,208 @@
+// Keyword sets are looked up in perfect hash tables that are generated at
+// compile time. A keyword is hashed on its length and a few of its characters,
+// multiplied by a seed. The generator tries seeds until every keyword of the
+// set lands in a slot of its own, so a lookup is one hash and one memcmp.
+
+// The seed that the generator starts at, and the amount of seeds it tries.
+const unsigned int keyword_first_seed = 0x9e3779b1;
+const int keyword_seed_tries = 128;
+
+// A list of indices, used to fill the slots of a table at compile time.
+template <size_t... I>
+struct index_list {
+	// The list of twice as many indices, and one more.
+	typedef index_list<I..., (sizeof...(I) + I)...> twice;
+	typedef index_list<I..., (sizeof...(I) + I)..., 2 * sizeof...(I)>
+		twice_plus_one;
+};
+
+// The list of the indices up to N.
+template <size_t N>
+struct index_sequence_of {
+	typedef typename index_sequence_of<N / 2>::type half;
+	typedef typename std::conditional<
+		N % 2 == 0,
+		typename half::twice,
+		typename half::twice_plus_one
+	>::type type;
+};
+template <>
+struct index_sequence_of<0> {
+	typedef index_list<> type;
+};
+
+// The list of the indices of a table with 2 ^ Bits slots.
+template <size_t Bits>
+struct slot_indices {
+	typedef typename slot_indices<Bits - 1>::type::twice type;
+};
+template <>
+struct slot_indices<0> {
+	typedef index_list<0> type;
+};
+
+// Get the length of a keyword.
+constexpr size_t keyword_length(const char* s) {
+	return *s ? 1 + keyword_length(s + 1) : 0;
+}
+
+// Hash a string of a certain length (at least one character) to a slot of a
+// table with 2 ^ bits slots. The length, the first two characters, the middle
+// character and the last character are hashed.
+constexpr unsigned int keyword_hash(const char* s,
+									size_t length,
+									unsigned int seed,
+									size_t bits)
+{
+	return ((((((unsigned int)length * 31u +
+			  (unsigned char)s[0]) * 31u +
+			  (unsigned char)s[length > 1]) * 31u +
+			  (unsigned char)s[length / 2]) * 31u +
+			  (unsigned char)s[length - 1]) * seed) >> (32 - bits);
+}
+
+// Get the slot of a keyword of a set.
+constexpr unsigned int keyword_slot(const char* const* keywords,
+									size_t i,
+									unsigned int seed,
+									size_t bits)
+{
+	return keyword_hash(
+		keywords[i],
+		keyword_length(keywords[i]),
+		seed,
+		bits
+	);
+}
+
+// Check if none of the keywords of a set from index j on land in a slot.
+constexpr bool keyword_slot_free(const char* const* keywords,
+								 size_t count,
+								 size_t j,
+								 unsigned int slot,
+								 unsigned int seed,
+								 size_t bits)
+{
+	return j >= count || (
+		keyword_slot(keywords, j, seed, bits) != slot &&
+		keyword_slot_free(keywords, count, j + 1, slot, seed, bits)
+	);
+}
+
+// Check if the keywords of a set from index i on all land in slots of their
+// own.
+constexpr bool keyword_seed_works(const char* const* keywords,
+								  size_t count,
+								  size_t i,
+								  unsigned int seed,
+								  size_t bits)
+{
+	return i >= count || (
+		keyword_slot_free(
+			keywords,
+			count,
+			i + 1,
+			keyword_slot(keywords, i, seed, bits),
+			seed,
+			bits
+		) &&
+		keyword_seed_works(keywords, count, i + 1, seed, bits)
+	);
+}
+
+// Find a seed that gives every keyword of a set a slot of its own, starting
+// at a seed. Returns zero if none of the tried seeds do.
+constexpr unsigned int keyword_seed(const char* const* keywords,
+									size_t count,
+									unsigned int seed,
+									size_t bits,
+									int tries)
+{
+	return tries == 0 ? 0 :
+		   keyword_seed_works(keywords, count, 0, seed, bits) ? seed :
+		   keyword_seed(keywords, count, seed + 2, bits, tries - 1);
+}
+
+// The slots and the lengths of the keywords of a set (of up to 255 keywords
+// of up to 255 characters each), for a seed.
+template <size_t N>
+struct keyword_hashes {
+	unsigned int seed;
+	unsigned int slots[N];
+	unsigned short lengths[N];
+};
+
+// Hash the keywords of a set with a seed.
+template <size_t Bits, size_t N, size_t... I>
+constexpr keyword_hashes<N> hash_keywords(const char* const* keywords,
+										  unsigned int seed,
+										  index_list<I...>)
+{
+	return {
+		seed,
+		{keyword_slot(keywords, I, seed, Bits)...},
+		{(unsigned short)keyword_length(keywords[I])...}
+	};
+}
+
+// Get the entry of a slot: the index of the keyword in it plus one (or zero
+// if it is empty) in the low byte, and the length of the keyword above it.
+template <size_t N>
+constexpr unsigned short keyword_entry(const keyword_hashes<N>& hashes,
+									   size_t i,
+									   unsigned int slot)
+{
+	return i >= N ? 0 :
+		   hashes.slots[i] == slot ?
+		   (unsigned short)((i + 1) | hashes.lengths[i] << 8) :
+		   keyword_entry(hashes, i + 1, slot);
+}
+
+// A perfect hash table of a keyword set, with 2 ^ Bits slots.
+template <size_t Bits>
+struct keyword_table {
+	// The seed of the hash, and the entries of the slots.
+	unsigned int seed;
+	unsigned short slots[1 << Bits];
+
+	// Check if a string is one of the keywords of the set.
+	bool find(const char* const* keywords,
+			  const char* text,
+			  size_t length) const
+	{
+		unsigned short entry = slots[keyword_hash(text, length, seed, Bits)];
+		return (entry >> 8) == length &&
+			   !memcmp(keywords[(entry & 0xff) - 1], text, length);
+	}
+};
+
+// Fill the slots of a perfect hash table.
+template <size_t Bits, size_t N, size_t... I>
+constexpr keyword_table<Bits> fill_keyword_table(
+	const keyword_hashes<N>& hashes,
+	index_list<I...>
+) {
+	return {hashes.seed, {keyword_entry(hashes, 0, I)...}};
+}
+
+// Generate the perfect hash table of a keyword set. The seed of the table is
+// zero if no seed was found, in which case the table needs more slots.
+template <size_t Bits, size_t N>
+constexpr keyword_table<Bits> make_keyword_table(
+	const char* const (&keywords)[N]
+) {
+	return fill_keyword_table<Bits>(
+		hash_keywords<Bits, N>(
+			keywords,
+			keyword_seed(
+				keywords,
+				N,
+				keyword_first_seed,
+				Bits,
+				keyword_seed_tries
+			),
+			typename index_sequence_of<N>::type()
+		),
+		typename slot_indices<Bits>::type()
+	);
+}
\ No newline at end of file
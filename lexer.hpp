@@ -0,0 +1,531 @@
+// A table-driven lexer, specialized for the syntax highlighting rules of a
+// language at compile time. It reads a contiguous range of text and returns
+// tokens as extents of the text, without copying any of it. Every character
+// is mapped to a character class by a table (built once per language), and a
+// transition table decides which token a character starts and which
+// characters continue it.
+//
+// The rules of a language are a struct of static functions:
+//
+//     is_keyword(text, length)  checks if an identifier is a keyword
+//     line_comment()            the two characters that start an inline comment
+//     block_open()              the two characters that open a multiline comment
+//     block_close()             the two characters that close it
+//     directive()               the character that starts a preprocessor
+//                               directive, or zero if there are none
+//     quotes()                  the characters that start string literals
+//     escape()                  the escape character of string literals
+//     colors()                  the color of every token type
+
+// All token types.
+enum token_type {
+	tk_eof,
+	tk_keyword,
+	tk_identifier,
+	tk_constant,
+	tk_string,
+	tk_special,
+	tk_operator,
+	tk_comment,
+	tk_directive,
+	tk_macro,
+	tk_whitespace
+};
+
+// Mappings from token_type to vga_color.
+vga_color token_to_color[] = {
+	vga_gray,
+	vga_white,
+	vga_gray,
+	vga_blue,
+	vga_blue,
+	vga_dark_green,
+	vga_dark_cyan,
+	vga_red,
+	vga_cyan,
+	vga_dark_cyan,
+	vga_gray
+};
+
+// All token types as strings.
+std::string token_type_str[] = {
+	"tk_eof",
+	"tk_keyword",
+	"tk_identifier",
+	"tk_constant",
+	"tk_string",
+	"tk_special",
+	"tk_operator",
+	"tk_comment",
+	"tk_directive",
+	"tk_macro",
+	"tk_whitespace"
+};
+
+// All character classes.
+enum char_class {
+	cc_other,
+	cc_space,
+	cc_letter,
+	cc_hex_letter,
+	cc_digit,
+	cc_sign,
+	cc_dot,
+	cc_operator,
+	cc_comment,
+	cc_special,
+	cc_quote,
+	cc_count
+};
+
+// All lexer states. A token starts in lr_start, and the class of its first
+// character decides the state of the rest of the token. Whitespace,
+// identifiers, operators and numerical constants are runs of characters that
+// stay in the same state; the other states are handled by scanning.
+enum lexer_run {
+	lr_start,
+	lr_space,
+	lr_identifier,
+	lr_operator,
+	lr_number,
+	lr_special,
+	lr_comment,
+	lr_quote,
+	lr_stop
+};
+
+// Get the character class of a character in a language. The characters that
+// start comments and string literals take precedence over the operators.
+template <class L>
+char_class classify(int c) {
+	if (c == ' ' || c == '\t' || c == '\n') {
+		return cc_space;
+	} else if (c >= '0' && c <= '9') {
+		return cc_digit;
+	} else if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') ||
+			   c == 'u' || c == 'U' || c == 'l' || c == 'L' ||
+			   c == 'x' || c == 'X')
+	{
+		return cc_hex_letter;
+	} else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+		return cc_letter;
+	} else if (c != 0 &&
+			   (c == L::line_comment()[0] || c == L::block_open()[0]))
+	{
+		return cc_comment;
+	} else if (c != 0 && strchr(L::quotes(), c)) {
+		return cc_quote;
+	} else if (c == '+' || c == '-') {
+		return cc_sign;
+	} else if (c == '.') {
+		return cc_dot;
+	} else if (c == '*' || c == '%' || c == '=' || c == '!' || c == '>' ||
+			   c == '<' || c == '&' || c == '|' || c == '^' || c == '~' ||
+			   c == '?' || c == ':' || c == '/')
+	{
+		return cc_operator;
+	} else if (c == '[' || c == ']' || c == '{' || c == '}' ||
+			   c == '(' || c == ')' || c == ';' || c == ',')
+	{
+		return cc_special;
+	}
+	return cc_other;
+}
+
+// The character class of every character in a language.
+template <class L>
+struct char_class_table {
+	unsigned char classes[256];
+
+	// Default constructor.
+	char_class_table() {
+		for (int c = 0; c < 256; c++) {
+			classes[c] = classify<L>(c);
+		}
+	}
+
+	// Get the character class of a character.
+	char_class operator[](char c) const {
+		return char_class(classes[(unsigned char)c]);
+	}
+};
+
+// The transition table. The row of lr_start gives the state that a character
+// starts a token in, and the rows of the runs give the state after another
+// character of the run (the run ends when the state changes).
+const unsigned char lexer_transitions[lr_stop][cc_count] = {
+	// lr_start
+	{
+		lr_stop,
+		lr_space,
+		lr_identifier,
+		lr_identifier,
+		lr_number,
+		lr_operator,
+		lr_operator,
+		lr_operator,
+		lr_comment,
+		lr_special,
+		lr_quote
+	},
+	// lr_space
+	{
+		lr_stop,
+		lr_space,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop
+	},
+	// lr_identifier
+	{
+		lr_stop,
+		lr_stop,
+		lr_identifier,
+		lr_identifier,
+		lr_identifier,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop
+	},
+	// lr_operator
+	{
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_operator,
+		lr_operator,
+		lr_operator,
+		lr_operator,
+		lr_stop,
+		lr_stop
+	},
+	// lr_number
+	{
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_number,
+		lr_number,
+		lr_number,
+		lr_number,
+		lr_stop,
+		lr_stop,
+		lr_stop,
+		lr_stop
+	},
+	// lr_special, lr_comment and lr_quote are not runs.
+	{lr_stop},
+	{lr_stop},
+	{lr_stop}
+};
+
+// Check if a character can be part of an identifier.
+inline bool is_identifier_char(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+		   (c >= '0' && c <= '9') || c == '_';
+}
+
+// Skip a run of identifier characters, and return the index of the first
+// character after it. The text is compared 16 characters at a time (SSE2),
+// and a character at a time for the remainder. Identifier characters are the
+// same in every language.
+inline size_t skip_identifier(const char* text, size_t i, size_t length) {
+	#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i case_16 = _mm_set1_epi8(0x20);
+	const __m128i a_16 = _mm_set1_epi8('a');
+	const __m128i zero_16 = _mm_set1_epi8('0');
+	const __m128i letters_16 = _mm_set1_epi8('z' - 'a');
+	const __m128i digits_16 = _mm_set1_epi8('9' - '0');
+	const __m128i underscore_16 = _mm_set1_epi8('_');
+	for (; i + 16 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+		// Characters are in a range if their distance to its start is at
+		// most its size (as unsigned bytes).
+		__m128i letter = _mm_sub_epi8(_mm_or_si128(chunk, case_16), a_16);
+		__m128i digit = _mm_sub_epi8(chunk, zero_16);
+		__m128i match = _mm_or_si128(
+			_mm_or_si128(
+				_mm_cmpeq_epi8(_mm_min_epu8(letter, letters_16), letter),
+				_mm_cmpeq_epi8(_mm_min_epu8(digit, digits_16), digit)
+			),
+			_mm_cmpeq_epi8(chunk, underscore_16)
+		);
+		unsigned int mask = ~_mm_movemask_epi8(match) & 0xffff;
+		if (mask) {
+			return i + trailing_zeros(mask);
+		}
+	}
+	#endif
+	while (i < length && is_identifier_char(text[i])) {
+		i++;
+	}
+	return i;
+}
+
+// Skip a run of whitespace, and return the index of the first character
+// after it. The text is compared 16 characters at a time (SSE2), and a
+// character at a time for the remainder.
+inline size_t skip_space(const char* text, size_t i, size_t length) {
+	#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i space_16 = _mm_set1_epi8(' ');
+	const __m128i tab_16 = _mm_set1_epi8('\t');
+	const __m128i newline_16 = _mm_set1_epi8('\n');
+	for (; i + 16 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+		__m128i match = _mm_or_si128(
+			_mm_or_si128(
+				_mm_cmpeq_epi8(chunk, space_16),
+				_mm_cmpeq_epi8(chunk, tab_16)
+			),
+			_mm_cmpeq_epi8(chunk, newline_16)
+		);
+		unsigned int mask = ~_mm_movemask_epi8(match) & 0xffff;
+		if (mask) {
+			return i + trailing_zeros(mask);
+		}
+	}
+	#endif
+	while (i < length &&
+		   (text[i] == ' ' || text[i] == '\t' || text[i] == '\n'))
+	{
+		i++;
+	}
+	return i;
+}
+
+// A token, as an extent of the text.
+struct token {
+	token_type type;
+	size_t offset;
+	size_t length;
+};
+
+// A lexer for the syntax highlighting rules of a language.
+template <class L>
+struct lexer {
+	// The character class of every character in the language.
+	static const char_class_table<L> char_classes;
+
+	// The text, and the position of the next token.
+	const char* text;
+	size_t length;
+	size_t pos = 0;
+
+	// If this lexer found an unclosed multiline comment (missing the
+	// two-character end sequence), the 'open' flag will be set.
+	bool open = false;
+
+	// If the first token found by this lexer was a preprocessor directive,
+	// this flag will be set.
+	bool directive = false;
+
+	// If the text ended inside an inline comment, the 'comment' flag will be
+	// set. If it ended inside a string literal, its quotation character is
+	// stored, and the 'escaped' flag is set if the last character was the
+	// escape character.
+	bool comment = false;
+	int quote = 0;
+	bool escaped = false;
+
+	// If this lexer continues the text of a previous lexer (the previous
+	// chunk of a long row), the 'continued' flag will be set.
+	bool continued = false;
+
+	// Default constructor. The state is the lexer state (see lexer_state)
+	// that the text continues from.
+	lexer(const char* text,
+		  size_t length,
+		  int state = 0,
+		  bool continued = false)
+	{
+		this->text = text;
+		this->length = length;
+		this->continued = continued;
+		open = state & ls_open;
+		if (continued) {
+			directive = state & ls_directive;
+			comment = state & ls_comment;
+			quote = state >> 8;
+			escaped = state & ls_escaped;
+		}
+	}
+
+	// Get the lexer state at the end of the text that has been read.
+	int state() {
+		return (open ? ls_open : 0) |
+			   (directive ? ls_directive : 0) |
+			   (comment ? ls_comment : 0) |
+			   (escaped ? ls_escaped : 0) |
+			   (quote << 8);
+	}
+
+	// Read the rest of a string literal from the specified index while
+	// handling escape codes. If the text ends inside the string, the
+	// quotation character is remembered.
+	size_t read_string(size_t i, int quotation, bool escaped) {
+		for (; i < length; i++) {
+			if (escaped) {
+				escaped = false;
+			} else if (text[i] == L::escape()) {
+				// Handling the escape character.
+				escaped = true;
+			} else if (text[i] == quotation) {
+				quote = 0;
+				this->escaped = false;
+				return i + 1;
+			}
+		}
+		quote = quotation;
+		this->escaped = escaped;
+		return length;
+	}
+
+	// Read an inline comment from the specified index, up to and including
+	// the next newline.
+	size_t read_inline_comment(size_t i) {
+		const char* newline = (const char*)memchr(text + i, '\n', length - i);
+		comment = !newline;
+		return newline ? newline - text + 1 : length;
+	}
+
+	// Read a multiline comment from the specified index, up to and including
+	// the two-character end sequence.
+	size_t read_multiline_comment(size_t i) {
+		const char* close = L::block_close();
+		while (i < length) {
+			const char* first = (const char*)memchr(
+				text + i,
+				close[0],
+				length - i
+			);
+			if (!first) {
+				break;
+			}
+			i = first - text + 1;
+			if (i < length && text[i] == close[1]) {
+				return i + 1;
+			}
+		}
+		open = true;
+		return length;
+	}
+
+	// Get the next token. Returns false at the end of the text, or at a
+	// character that no token can start with.
+	bool next(token& out) {
+		// Check for the end of the text.
+		if (pos >= length) {
+			return false;
+		}
+		size_t start = pos;
+
+		// Continue parsing open multiline comments, string literals and
+		// inline comments that the previous text ended in.
+		if (start == 0 && open) {
+			open = false;
+			pos = read_multiline_comment(0);
+			out = {tk_comment, start, pos - start};
+			return true;
+		} else if (start == 0 && quote) {
+			pos = read_string(0, quote, escaped);
+			out = {tk_string, start, pos - start};
+			return true;
+		} else if (start == 0 && comment) {
+			pos = read_inline_comment(0);
+			out = {tk_comment, start, pos - start};
+			return true;
+		}
+
+		// Check for preprocessor directives.
+		if (L::directive() && start == 0 && !continued) {
+			size_t i = skip_space(text, 0, length);
+			if (i < length && text[i] == L::directive()) {
+				directive = true;
+				i = skip_space(text, i + 1, length);
+				pos = skip_identifier(text, i, length);
+				out = {tk_directive, start, pos - start};
+				return true;
+			}
+		}
+
+		// Check for text following a preprocessor directive.
+		if (directive) {
+			pos = length;
+			out = {tk_macro, start, pos - start};
+			return true;
+		}
+
+		// Find the state of the token from its first character.
+		int run = lexer_transitions[lr_start][char_classes[text[start]]];
+		switch (run) {
+			case lr_space: {
+				pos = skip_space(text, start + 1, length);
+				out = {tk_whitespace, start, pos - start};
+				return true;
+			}
+			case lr_identifier: {
+				pos = skip_identifier(text, start + 1, length);
+				bool keyword = L::is_keyword(text + start, pos - start);
+				out = {keyword ? tk_keyword : tk_identifier, start, pos - start};
+				return true;
+			}
+			case lr_special: {
+				pos = start + 1;
+				out = {tk_special, start, 1};
+				return true;
+			}
+			case lr_quote: {
+				pos = read_string(start + 1, text[start], false);
+				out = {tk_string, start, pos - start};
+				return true;
+			}
+			case lr_comment: {
+				// Check for comments. Characters that start comments are
+				// operators otherwise.
+				char c = text[start];
+				char d = start + 1 < length ? text[start + 1] : 0;
+				if (c == L::line_comment()[0] && d == L::line_comment()[1]) {
+					pos = read_inline_comment(start);
+					out = {tk_comment, start, pos - start};
+					return true;
+				} else if (c == L::block_open()[0] && d == L::block_open()[1]) {
+					pos = read_multiline_comment(start + 1);
+					out = {tk_comment, start, pos - start};
+					return true;
+				}
+				run = lr_operator;
+				break;
+			}
+			case lr_stop: {
+				// Something weird is going on.
+				return false;
+			}
+		}
+
+		// Read the rest of an operator or a numerical constant.
+		size_t i = start + 1;
+		while (i < length &&
+			   lexer_transitions[run][char_classes[text[i]]] == run)
+		{
+			i++;
+		}
+		pos = i;
+		out = {run == lr_number ? tk_constant : tk_operator, start, i - start};
+		return true;
+	}
+};
+
+// The character class table of a language is built once.
+template <class L>
+const char_class_table<L> lexer<L>::char_classes;
\ No newline at end of file
@@ -0,0 +1,843 @@
+// The maximum amount of NFA states of a compiled pattern.
+const size_t regex_max_states = 1 << 16;
+
+// The maximum amount of cached DFA states of an automaton. The cache is
+// flushed when it is full.
+const size_t regex_max_cache = 1 << 12;
+
+// All kinds of nodes of a parsed pattern.
+enum regex_kind {
+	rx_set,
+	rx_begin,
+	rx_end,
+	rx_concat,
+	rx_alternate,
+	rx_repeat
+};
+
+// A node of a parsed pattern.
+struct regex_node {
+	regex_kind kind;
+
+	// The characters a set matches.
+	std::bitset<256> set;
+
+	// The children of a concatenation, alternation or repetition.
+	std::vector<int> children;
+
+	// The bounds of a repetition (max is -1 if unbounded).
+	int min;
+	int max;
+};
+
+// All kinds of NFA states.
+enum nfa_kind {
+	nk_set,
+	nk_split,
+	nk_begin,
+	nk_end,
+	nk_match
+};
+
+// An NFA state. Set states consume a character of a set and move on to out,
+// split states move on to both out and out1 without consuming anything, and
+// the begin and end states only move on to out at the start or the end of a
+// line.
+struct nfa_state {
+	nfa_kind kind;
+	int set;
+	int out;
+	int out1;
+};
+
+// The flags of a DFA state. If the NFA reaches its match state, df_accept
+// will be set; if it does at the end of a line, df_accept_at_end will be set.
+// If no NFA states are left, df_dead will be set.
+enum dfa_flag {
+	df_accept = 1,
+	df_accept_at_end = 2,
+	df_dead = 4
+};
+
+// A DFA state that a forward run of a regular expression was in at a position
+// of a line, and the run. The steps at the same position are linked into a
+// list.
+struct match_step {
+	int state;
+	size_t run;
+	size_t next;
+};
+
+// An automaton. The NFA is turned into a DFA lazily: a DFA state and its
+// transitions are only built when the input reaches them, so matching takes
+// linear time without building the whole (possibly huge) DFA up front.
+class automaton {
+private:
+	// The amount of characters classes, and the class of every character.
+	// Characters of the same class are matched by the same sets.
+	int classes = 1;
+	unsigned char character_class[256] = {};
+
+	// The cached DFA states (the set of NFA states every DFA state stands
+	// for), and their transitions (one per class, -1 if not built yet) and
+	// flags. A DFA state is identified by the offset of its transitions, so
+	// that stepping needs no multiplication, and its flags are stored at the
+	// same offset.
+	std::vector<std::vector<int>> cache;
+	std::vector<int> transitions;
+	std::vector<unsigned char> flags;
+	std::map<std::vector<int>, int> lookup;
+
+	// The DFA states at the start of the input (at the start of a line, and
+	// elsewhere; -1 if not built yet).
+	int starts[2] = {-1, -1};
+
+	// The amount of times the cache has been flushed.
+	size_t flushes = 0;
+
+	// Add the states reachable from a state without consuming characters.
+	// Begin states are only followed at the start of a line, and end states
+	// only at the end of a line.
+	void closure(int state,
+				 bool at_begin,
+				 bool at_end,
+				 std::vector<int>& out,
+				 std::vector<char>& seen)
+	{
+		std::vector<int> stack(1, state);
+		while (!stack.empty()) {
+			int s = stack.back();
+			stack.pop_back();
+			if (s < 0 || seen[s]) {
+				continue;
+			}
+			seen[s] = 1;
+			out.push_back(s);
+			nfa_state& n = states[s];
+			if (n.kind == nk_split) {
+				stack.push_back(n.out1);
+				stack.push_back(n.out);
+			} else if (n.kind == nk_begin && at_begin) {
+				stack.push_back(n.out);
+			} else if (n.kind == nk_end && at_end) {
+				stack.push_back(n.out);
+			}
+		}
+	}
+
+	// Find (or build) the DFA state for a set of NFA states.
+	int intern(std::vector<int>& set, bool at_begin) {
+		std::sort(set.begin(), set.end());
+		std::vector<int> key = set;
+		key.push_back(at_begin ? -1 : -2);
+		auto found = lookup.find(key);
+		if (found != lookup.end()) {
+			return found->second;
+		}
+
+		// Flush the cache when it is full.
+		if (cache.size() >= regex_max_cache) {
+			flush();
+		}
+
+		unsigned char f = set.empty() ? df_dead : 0;
+
+		// Check if the match state is reached, either right away or once the
+		// end states are followed.
+		std::vector<int> ends;
+		std::vector<char> seen(states.size(), 0);
+		for (size_t i = 0; i < set.size(); i++) {
+			if (states[set[i]].kind == nk_match) {
+				f |= df_accept;
+			}
+			closure(set[i], at_begin, true, ends, seen);
+		}
+		for (size_t i = 0; i < ends.size(); i++) {
+			if (states[ends[i]].kind == nk_match) {
+				f |= df_accept_at_end;
+			}
+		}
+
+		int state = cache.size() * classes;
+		cache.push_back(set);
+		transitions.resize(cache.size() * classes, -1);
+		flags.resize(cache.size() * classes, 0);
+		flags[state] = f;
+		lookup[key] = state;
+		return state;
+	}
+
+	// Build the transition of a DFA state on a character.
+	int transition(int state, unsigned char c) {
+		std::vector<int> set;
+		std::vector<char> seen(states.size(), 0);
+		const std::vector<int>& from = cache[state / classes];
+		for (size_t i = 0; i < from.size(); i++) {
+			nfa_state& n = states[from[i]];
+			if (n.kind == nk_set && sets[n.set][c]) {
+				closure(n.out, false, false, set, seen);
+			}
+		}
+		size_t before = flushes;
+		int target = intern(set, false);
+		// The transition can only be cached if the cache was not flushed
+		// while the target was built.
+		if (flushes == before) {
+			transitions[state + character_class[c]] = target;
+		}
+		return target;
+	}
+
+	// Discard all cached DFA states.
+	void flush() {
+		flushes++;
+		cache.clear();
+		flags.clear();
+		transitions.clear();
+		lookup.clear();
+		starts[0] = -1;
+		starts[1] = -1;
+	}
+
+public:
+	// The NFA states, the start state, and the character sets.
+	std::vector<nfa_state> states;
+	int start = -1;
+	std::vector<std::bitset<256>> sets;
+
+	// Split the characters into classes, so that the DFA only needs one
+	// transition per class. Call this once the NFA is complete.
+	void finish() {
+		flush();
+		classes = 1;
+		memset(character_class, 0, sizeof(character_class));
+		for (size_t i = 0; i < sets.size(); i++) {
+			// Split every class in the characters inside and outside the set.
+			int split[512];
+			for (int j = 0; j < 512; j++) {
+				split[j] = -1;
+			}
+			int count = 0;
+			for (int c = 0; c < 256; c++) {
+				int key = character_class[c] * 2 + sets[i][c];
+				if (split[key] < 0) {
+					split[key] = count++;
+				}
+				character_class[c] = split[key];
+			}
+			classes = count;
+		}
+	}
+
+	// Get the DFA state at the start of the input.
+	int begin(bool at_begin) {
+		if (starts[at_begin] < 0) {
+			std::vector<int> set;
+			std::vector<char> seen(states.size(), 0);
+			closure(start, at_begin, false, set, seen);
+			starts[at_begin] = intern(set, at_begin);
+		}
+		return starts[at_begin];
+	}
+
+	// Get the DFA state after a character has been consumed.
+	int step(int state, unsigned char c) {
+		int target = transitions[state + character_class[c]];
+		return target >= 0 ? target : transition(state, c);
+	}
+
+	// Get the flags of a DFA state.
+	bool accept(int state) {
+		return flags[state] & df_accept;
+	}
+	bool accept_at_end(int state) {
+		return flags[state] & df_accept_at_end;
+	}
+	bool dead(int state) {
+		return flags[state] & df_dead;
+	}
+
+	// Get the amount of times the cache has been flushed. A flush invalidates
+	// every DFA state that was returned before it.
+	size_t flush_count() const {
+		return flushes;
+	}
+};
+
+// A regular expression. Patterns support literal characters, ".", character
+// classes ("[a-z]", "[^0-9]"), the escapes "\d", "\w", "\s" (and their
+// negations "\D", "\W", "\S"), "\t", "\n" and escaped metacharacters,
+// grouping with "(" and ")", alternation with "|", the repetitions "*", "+",
+// "?" and "{m,n}", and the anchors "^" and "$" (the start and the end of a
+// line). Matches never span lines, and the leftmost-longest match wins.
+//
+// A pattern is compiled to two lazy DFAs: one that runs backwards over a
+// line to find every position where a match starts, and one that runs
+// forwards from such a position to find where the longest match ends. There
+// is no backtracking, so no pattern can take exponential time. The forward
+// runs share their work, so a line takes time linear in its length (times
+// the amount of DFA states that the runs are in at the same position).
+class regex {
+private:
+	// The parsed pattern.
+	std::vector<regex_node> nodes;
+	std::string pattern;
+	size_t position = 0;
+
+	// The nesting depth of the groups being parsed.
+	int depth = 0;
+
+	// The forward automaton (anchored at the start of the match), and the
+	// reverse automaton (which finds every start of a match).
+	automaton forward;
+	automaton reverse;
+
+	// The positions where a match starts, for the line being searched.
+	std::vector<char> starts;
+
+	// The DFA states the forward runs were in past the ends of their matches,
+	// for the line being searched (the first step at every position that
+	// has steps), and the end of the longest match of every run.
+	std::map<size_t, size_t> trail;
+	std::vector<match_step> steps;
+	std::vector<size_t> run_ends;
+
+	// Add a node to the parsed pattern.
+	int node(regex_kind kind) {
+		regex_node n;
+		n.kind = kind;
+		n.min = 0;
+		n.max = 0;
+		nodes.push_back(n);
+		return nodes.size() - 1;
+	}
+
+	// Add a set node to the parsed pattern.
+	int set_node(const std::bitset<256>& set) {
+		int n = node(rx_set);
+		nodes[n].set = set;
+		return n;
+	}
+
+	// Fail to compile the pattern.
+	int fail(std::string message) {
+		if (error.empty()) {
+			error = message;
+		}
+		return -1;
+	}
+
+	// Parse an escape sequence (after the backslash) into a set.
+	bool escape(std::bitset<256>& set) {
+		if (position >= pattern.size()) {
+			return false;
+		}
+		char c = pattern[position++];
+		set.reset();
+		if (c == 'd' || c == 'D') {
+			for (int i = '0'; i <= '9'; i++) {
+				set[i] = true;
+			}
+		} else if (c == 'w' || c == 'W') {
+			for (int i = 0; i < 256; i++) {
+				set[i] = isalnum(i) || i == '_';
+			}
+		} else if (c == 's' || c == 'S') {
+			for (const char* i = " \t\r\f\v"; *i; i++) {
+				set[(unsigned char)*i] = true;
+			}
+		} else if (c == 't') {
+			set['\t'] = true;
+		} else if (c == 'n') {
+			set['\n'] = true;
+		} else {
+			set[(unsigned char)c] = true;
+		}
+		if (c == 'D' || c == 'W' || c == 'S') {
+			set.flip();
+		}
+		return true;
+	}
+
+	// Parse a character class (after the opening bracket).
+	int parse_class() {
+		std::bitset<256> set;
+		bool negate = false;
+		if (position < pattern.size() && pattern[position] == '^') {
+			negate = true;
+			position++;
+		}
+		bool first = true;
+		while (position < pattern.size() &&
+			   (pattern[position] != ']' || first))
+		{
+			first = false;
+			std::bitset<256> item;
+			unsigned char low = pattern[position++];
+			if (low == '\\') {
+				if (!escape(item)) {
+					return fail("Unterminated escape");
+				}
+				if (item.count() != 1) {
+					set |= item;
+					continue;
+				}
+				low = 0;
+				while (!item[low]) {
+					low++;
+				}
+			}
+			unsigned char high = low;
+			if (position + 1 < pattern.size() &&
+				pattern[position] == '-' &&
+				pattern[position + 1] != ']')
+			{
+				high = pattern[position + 1];
+				position += 2;
+				if (high == '\\') {
+					if (!escape(item) || item.count() != 1) {
+						return fail("Invalid range");
+					}
+					high = 0;
+					while (!item[high]) {
+						high++;
+					}
+				}
+				if (high < low) {
+					return fail("Invalid range");
+				}
+			}
+			for (int i = low; i <= high; i++) {
+				set[i] = true;
+			}
+		}
+		if (position >= pattern.size()) {
+			return fail("Unterminated character class");
+		}
+		position++;
+		if (negate) {
+			set.flip();
+		}
+		return set_node(set);
+	}
+
+	// Parse a number of a repetition.
+	int parse_number() {
+		int number = -1;
+		while (position < pattern.size() && isdigit(pattern[position])) {
+			number = std::max(number, 0) * 10 + pattern[position++] - '0';
+			if (number > 1000) {
+				return -2;
+			}
+		}
+		return number;
+	}
+
+	// Parse an atom.
+	int parse_atom() {
+		char c = pattern[position++];
+		std::bitset<256> set;
+		if (c == '(') {
+			if (++depth > 1000) {
+				return fail("Too many nested groups");
+			}
+			int inner = parse_alternation();
+			depth--;
+			if (position >= pattern.size() || pattern[position] != ')') {
+				return fail("Missing )");
+			}
+			position++;
+			return inner;
+		} else if (c == '[') {
+			return parse_class();
+		} else if (c == '.') {
+			set.set();
+			set['\n'] = false;
+			return set_node(set);
+		} else if (c == '^') {
+			return node(rx_begin);
+		} else if (c == '$') {
+			return node(rx_end);
+		} else if (c == '\\') {
+			if (!escape(set)) {
+				return fail("Unterminated escape");
+			}
+			return set_node(set);
+		} else if (c == '*' || c == '+' || c == '?' || c == '{') {
+			return fail("Nothing to repeat");
+		} else if (c == ')') {
+			return fail("Unmatched )");
+		}
+		set[(unsigned char)c] = true;
+		return set_node(set);
+	}
+
+	// Parse an atom followed by repetitions.
+	int parse_repeat() {
+		int atom = parse_atom();
+		while (atom >= 0 && position < pattern.size()) {
+			char c = pattern[position];
+			int min;
+			int max;
+			if (c == '*') {
+				min = 0;
+				max = -1;
+			} else if (c == '+') {
+				min = 1;
+				max = -1;
+			} else if (c == '?') {
+				min = 0;
+				max = 1;
+			} else if (c == '{') {
+				position++;
+				min = parse_number();
+				max = min;
+				if (position < pattern.size() && pattern[position] == ',') {
+					position++;
+					max = parse_number();
+				}
+				if (min < 0 || max == -2 || (max >= 0 && max < min) ||
+					position >= pattern.size() || pattern[position] != '}')
+				{
+					return fail("Invalid repetition");
+				}
+			} else {
+				break;
+			}
+			position++;
+			int n = node(rx_repeat);
+			nodes[n].children.push_back(atom);
+			nodes[n].min = min;
+			nodes[n].max = max;
+			atom = n;
+		}
+		return atom;
+	}
+
+	// Parse a concatenation.
+	int parse_concatenation() {
+		int n = node(rx_concat);
+		while (position < pattern.size() &&
+			   pattern[position] != '|' &&
+			   pattern[position] != ')')
+		{
+			int child = parse_repeat();
+			if (child < 0) {
+				return -1;
+			}
+			nodes[n].children.push_back(child);
+		}
+		return n;
+	}
+
+	// Parse an alternation.
+	int parse_alternation() {
+		int n = node(rx_alternate);
+		for (;;) {
+			int child = parse_concatenation();
+			if (child < 0) {
+				return -1;
+			}
+			nodes[n].children.push_back(child);
+			if (position >= pattern.size() || pattern[position] != '|') {
+				return n;
+			}
+			position++;
+		}
+	}
+
+	// Add an NFA state to an automaton.
+	static int state(automaton& a, nfa_kind kind, int out, int out1 = -1) {
+		a.states.push_back({kind, -1, out, out1});
+		if (a.states.size() > regex_max_states) {
+			return -1;
+		}
+		return a.states.size() - 1;
+	}
+
+	// Build the NFA of a node that continues to the specified state. If
+	// reversed is set, the NFA matches the reversed pattern.
+	int build(automaton& a, int n, int next, bool reversed) {
+		if (next < 0) {
+			return -1;
+		}
+		regex_node& r = nodes[n];
+		if (r.kind == rx_set) {
+			a.sets.push_back(r.set);
+			int s = state(a, nk_set, next);
+			if (s >= 0) {
+				a.states[s].set = a.sets.size() - 1;
+			}
+			return s;
+		} else if (r.kind == rx_begin) {
+			return state(a, reversed ? nk_end : nk_begin, next);
+		} else if (r.kind == rx_end) {
+			return state(a, reversed ? nk_begin : nk_end, next);
+		} else if (r.kind == rx_concat) {
+			// Build the children back to front, as each one continues to
+			// the one after it.
+			std::vector<int> children = r.children;
+			if (reversed) {
+				std::reverse(children.begin(), children.end());
+			}
+			for (size_t i = children.size(); i-- > 0;) {
+				next = build(a, children[i], next, reversed);
+			}
+			return next;
+		} else if (r.kind == rx_alternate) {
+			int s = build(a, r.children.back(), next, reversed);
+			for (size_t i = r.children.size() - 1; i-- > 0;) {
+				s = state(a, nk_split, build(a, r.children[i], next, reversed), s);
+			}
+			return s;
+		}
+
+		// Build a repetition: the optional (or looping) part first, then the
+		// required copies in front of it.
+		int child = r.children[0];
+		int tail = next;
+		if (r.max < 0) {
+			int loop = state(a, nk_split, -1, next);
+			if (loop < 0) {
+				return -1;
+			}
+			int body = build(a, child, loop, reversed);
+			a.states[loop].out = body;
+			tail = loop;
+		} else {
+			for (int i = r.min; i < r.max && tail >= 0; i++) {
+				tail = state(a, nk_split, build(a, child, tail, reversed), next);
+			}
+		}
+		for (int i = 0; i < r.min && tail >= 0; i++) {
+			tail = build(a, child, tail, reversed);
+		}
+		return tail;
+	}
+
+public:
+	// The error message of the last compilation (empty if it succeeded).
+	std::string error;
+
+	// Compile a pattern. Returns false if the pattern is invalid.
+	bool compile(const std::string& text) {
+		nodes.clear();
+		pattern = text;
+		position = 0;
+		depth = 0;
+		error.clear();
+		forward = automaton();
+		reverse = automaton();
+		int root = parse_alternation();
+		if (root >= 0 && position < pattern.size()) {
+			root = fail("Unmatched )");
+		}
+		if (root < 0) {
+			return false;
+		}
+
+		// Build the forward NFA.
+		int match = state(forward, nk_match, -1);
+		forward.start = build(forward, root, match, false);
+
+		// Build the reverse NFA, with a loop in front of it so that matches
+		// can end anywhere.
+		match = state(reverse, nk_match, -1);
+		int start = build(reverse, root, match, true);
+		std::bitset<256> any;
+		any.set();
+		reverse.sets.push_back(any);
+		int loop = state(reverse, nk_split, start, -1);
+		int skip = state(reverse, nk_set, loop);
+		if (loop >= 0 && skip >= 0) {
+			reverse.states[skip].set = reverse.sets.size() - 1;
+			reverse.states[loop].out1 = skip;
+		}
+		reverse.start = loop;
+
+		if (forward.start < 0 || reverse.start < 0 || skip < 0) {
+			error = "Pattern is too big";
+			return false;
+		}
+		forward.finish();
+		reverse.finish();
+		return true;
+	}
+
+	// Find every match in a line of text, and call a function with the start
+	// and the end of each, as f(start, end). After a match, the search goes
+	// on at its end (or after its start if it is empty).
+	template <class F>
+	void find_all(const char* text, size_t length, F found) {
+		// Run the reverse automaton from the end of the line, to find every
+		// position where a match starts.
+		starts.assign(length + 1, 0);
+		bool any = false;
+		int s = reverse.begin(true);
+		for (size_t i = length + 1; i-- > 0;) {
+			if (i < length) {
+				s = reverse.step(s, text[i]);
+			}
+			if (reverse.accept(s) || (i == 0 && reverse.accept_at_end(s))) {
+				starts[i] = 1;
+				any = true;
+			}
+		}
+		if (!any) {
+			return;
+		}
+
+		// Run the forward automaton from every start, to find the longest
+		// match. A run that reaches a DFA state that an earlier run was in
+		// at the same position has the same future, so it stops there and
+		// takes the end of the earlier run if that is further. Every DFA
+		// state is stepped through at most once per position.
+		trail.clear();
+		steps.clear();
+		run_ends.clear();
+		size_t flushes = forward.flush_count();
+		size_t from = 0;
+		while (from <= length) {
+			while (from <= length && !starts[from]) {
+				from++;
+			}
+			if (from > length) {
+				break;
+			}
+			size_t end = from;
+			s = forward.begin(from == 0);
+			for (size_t i = from; i < length && !forward.dead(s); i++) {
+				s = forward.step(s, text[i]);
+				if (forward.accept(s) ||
+					(i + 1 == length && forward.accept_at_end(s)))
+				{
+					end = i + 1;
+				}
+
+				// The DFA states of the earlier runs are not valid after a
+				// flush, so they are forgotten.
+				if (forward.flush_count() != flushes) {
+					flushes = forward.flush_count();
+					trail.clear();
+					steps.clear();
+				}
+
+				// Look for an earlier run in the same state.
+				size_t k = -1;
+				if (!trail.empty()) {
+					auto first = trail.find(i + 1);
+					k = first != trail.end() ? first->second : -1;
+				}
+				while (k != size_t(-1) && steps[k].state != s) {
+					k = steps[k].next;
+				}
+				if (k != size_t(-1)) {
+					if (run_ends[steps[k].run] > i + 1) {
+						end = run_ends[steps[k].run];
+					}
+					break;
+				}
+
+				// Later runs start at or after the end of this match, so
+				// only the steps after it are recorded.
+				if (i + 1 > end && !forward.dead(s)) {
+					size_t& first = trail.emplace(i + 1, -1).first->second;
+					steps.push_back({s, run_ends.size(), first});
+					first = steps.size() - 1;
+				}
+			}
+			run_ends.push_back(end);
+			found(from, end);
+			from = end > from ? end : from + 1;
+
+			// Later runs only step past the start of the next run.
+			trail.erase(trail.begin(), trail.upper_bound(from));
+		}
+	}
+
+	// Find the first match in a line of text that starts at or after a
+	// position. Returns false if there is none.
+	bool find(const char* text,
+			  size_t length,
+			  size_t from,
+			  size_t& start,
+			  size_t& end)
+	{
+		bool matched = false;
+		find_all(text, length, [&](size_t s, size_t e) {
+			if (!matched && s >= from) {
+				start = s;
+				end = e;
+				matched = true;
+			}
+		});
+		return matched;
+	}
+};
+
+// Escape the metacharacters of a string, so that it can be used as a
+// pattern that matches the string itself.
+std::string regex_escape(const std::string& text) {
+	std::string escaped;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (strchr("\\^$.|?*+()[]{}", text[i]) && text[i]) {
+			escaped += '\\';
+		}
+		escaped += text[i];
+	}
+	return escaped;
+}
+
+// Replace every match of a regular expression in a range of text that holds
+// whole lines, and append the result to a string. In the replacement, "$0"
+// stands for the match and "$$" for a dollar sign. Returns the amount of
+// replaced matches.
+size_t regex_replace(regex& expression,
+					 const char* text,
+					 size_t length,
+					 const std::string& replacement,
+					 std::string& out)
+{
+	size_t count = 0;
+	size_t copied = 0;
+	size_t line = 0;
+	for (;;) {
+		// Find the end of the line.
+		const char* newline = (const char*)memchr(
+			text + line,
+			'\n',
+			length - line
+		);
+		size_t end = newline ? newline - text : length;
+
+		// Copy the text up to every match, and the replacement instead of
+		// the match. Text without matches is copied in one go later on.
+		expression.find_all(
+			text + line,
+			end - line,
+			[&](size_t s, size_t e) {
+				out.append(text + copied, line + s - copied);
+				for (size_t i = 0; i < replacement.size(); i++) {
+					if (replacement[i] == '$' && i + 1 < replacement.size()) {
+						if (replacement[i + 1] == '0') {
+							out.append(text + line + s, e - s);
+							i++;
+							continue;
+						} else if (replacement[i + 1] == '$') {
+							i++;
+						}
+					}
+					out += replacement[i];
+				}
+				copied = line + e;
+				count++;
+			}
+		);
+		if (!newline) {
+			break;
+		}
+		line = end + 1;
+	}
+	out.append(text + copied, length - copied);
+	return count;
+}
\ No newline at end of file
@@ -1,63 +1,766 @@
-// A row of glyphs/characters.
-class row: public std::vector<glyph> {
+// A run of characters of a row that share a foreground color.
+struct span {
+	unsigned int start;
+	unsigned int length;
+	unsigned char color;
+};
+
+// A list of color spans, allocated from the row arena.
+typedef std::vector<span, arena_allocator<span, &row_storage>> span_list;
+
+// The amount of characters per block of the display column index of a row.
+// Rows that are shorter than a block have no index.
+const size_t row_column_block = 256;
+
+// A list of display columns, allocated from the row arena.
+typedef std::vector<
+	unsigned int,
+	arena_allocator<unsigned int, &row_storage>
+> column_list;
+
+// The size that long rows are split into chunks of. Chunks grow up to twice
+// this size before they are split again.
+const size_t row_chunk_size = 1 << 14;
+
+// Rows that grow longer than this are stored as a list of chunks, so that an
+// edit only moves the characters of one chunk. Long rows that shrink to half
+// of this size are stored in a single gap buffer again.
+const size_t row_long_size = 1 << 16;
+
+// Get the length of the first chunk of the text of a long row. Chunks are
+// split before a space or tab near the chunk size if there is one, so that
+// most tokens are not split between chunks.
+inline size_t chunk_length(const char* text, size_t length) {
+	size_t count = std::min(row_chunk_size, length);
+	for (size_t j = count; count < length && j > count - 256; j--) {
+		if (text[j] == ' ' || text[j] == '\t') {
+			return j;
+		}
+	}
+	return count;
+}
+
+class row;
+
+// A list of the chunks of a long row, allocated from the row arena.
+typedef std::vector<row*, arena_allocator<row*, &row_storage>> chunk_list;
+
+// A list of offsets, allocated from the row arena.
+typedef std::vector<size_t, arena_allocator<size_t, &row_storage>> offset_list;
+
+// A row of characters. The characters are stored in a gap buffer: a single
+// allocation with a gap at the position of the last edit, so consecutive
+// edits at the same position only ever touch the inserted or erased
+// characters, and moving the gap moves each character in between exactly
+// once. Long rows (like minified files) are stored as a list of chunks
+// instead, each of which is a row with its own gap buffer, color spans and
+// display column index. Syntax highlighting is kept apart from the text as a
+// list of color spans. All row memory is allocated from the row arena.
+class row {
+private:
+	// The character storage, including the gap.
+	char* data = NULL;
+	// The capacity of the character storage (in characters).
+	size_t capacity = 0;
+
+	// The bounds of the gap. The gap spans from gap_start up to (but not
+	// including) gap_end.
+	size_t gap_start = 0;
+	size_t gap_end = 0;
+
+	// The display column index: the display column at the start of every
+	// block of characters (after the first), and the amount of those that
+	// are up to date. Edits only invalidate the blocks after the edit, and
+	// the index is brought up to date when it is used.
+	column_list columns;
+	size_t measured = 0;
+
+	// The index of the first tab (or the size of this row if it has none),
+	// or -1 if it has not been looked for since the last edit.
+	size_t tab = -1;
+
+	// The display width of this row, or -1 if it has not been measured since
+	// the last edit.
+	unsigned int full_width = -1;
+
+	// The chunks of a long row (empty for other rows), the offset of the
+	// first character of every chunk followed by the size of the row, and the
+	// chunk of the last character that was accessed.
+	chunk_list chunks;
+	offset_list starts;
+	size_t last = 0;
+
+	// The display column at the start of every chunk, followed by the
+	// display width of the row, and the amount of those that are up to date.
+	column_list chunk_columns;
+	size_t chunks_measured = 0;
+
+	// Mark the display column index as outdated after the specified index.
+	void invalidate(size_t index) {
+		measured = std::min(measured, index / row_column_block);
+		tab = -1;
+		full_width = -1;
+		entry_state = -1;
+	}
+
+	// Advance a display column over a range of characters. Tabs advance to
+	// the next multiple of four columns.
+	unsigned int advance(unsigned int column, size_t from, size_t to) {
+		for (size_t i = from; i < to; i++) {
+			if ((*this)[i] == '\t') {
+				column = (column / 4) * 4 + 4;
+			} else {
+				column++;
+			}
+		}
+		return column;
+	}
+
+	// Bring the display column index up to date for the specified amount of
+	// blocks (after the first).
+	void measure(size_t blocks) {
+		blocks = std::min(blocks, size() / row_column_block);
+		if (columns.size() < blocks) {
+			columns.resize(blocks);
+		}
+		for (; measured < blocks; measured++) {
+			columns[measured] = advance(
+				measured ? columns[measured - 1] : 0,
+				measured * row_column_block,
+				(measured + 1) * row_column_block
+			);
+		}
+	}
+
+	// Move the gap so that it starts at the specified index.
+	void move_gap(size_t index) {
+		if (index < gap_start) {
+			size_t count = gap_start - index;
+			memmove(data + gap_end - count, data + index, count);
+			gap_start -= count;
+			gap_end -= count;
+		} else if (index > gap_start) {
+			size_t count = index - gap_start;
+			memmove(data + gap_start, data + gap_end, count);
+			gap_start += count;
+			gap_end += count;
+		}
+	}
+
+	// Make sure the gap can hold at least the specified amount of characters.
+	void reserve_gap(size_t count) {
+		if (data && gap_end - gap_start >= count) {
+			return;
+		}
+		size_t length = size();
+		size_t new_capacity = capacity * 2;
+		if (new_capacity < length + count + 16) {
+			new_capacity = length + count + 16;
+		}
+		// Use all of the arena block.
+		new_capacity = arena::block_size(new_capacity);
+		char* new_data = (char*)row_storage->allocate(new_capacity);
+		// Copy both sides of the gap to their new positions.
+		size_t after = capacity - gap_end;
+		if (data) {
+			memcpy(new_data, data, gap_start);
+			memcpy(new_data + new_capacity - after, data + gap_end, after);
+			row_storage->deallocate(data, capacity);
+		}
+		data = new_data;
+		gap_end = new_capacity - after;
+		capacity = new_capacity;
+	}
+
+	// Insert characters into the gap buffer.
+	void insert_flat(size_t index, const char* element, size_t length) {
+		invalidate(index);
+		move_gap(index);
+		reserve_gap(length);
+		memcpy(data + gap_start, element, length);
+		gap_start += length;
+	}
+
+	// Erase characters from the gap buffer.
+	void erase_flat(size_t index, size_t count) {
+		invalidate(index);
+		move_gap(index);
+		gap_end += count;
+	}
+
+	// Split the gap buffer at a certain index, and return the right side.
+	row split_flat(size_t index) {
+		invalidate(index);
+		move_gap(index);
+		row right;
+		right.reserve_gap(capacity - gap_end);
+		memcpy(right.data, data + gap_end, capacity - gap_end);
+		right.gap_start = capacity - gap_end;
+		gap_end = capacity;
+		return right;
+	}
+
+	// Free the gap buffer.
+	void release_flat() {
+		if (data) {
+			row_storage->deallocate(data, capacity);
+		}
+		data = NULL;
+		capacity = 0;
+		gap_start = 0;
+		gap_end = 0;
+		columns.clear();
+		measured = 0;
+		tab = -1;
+		full_width = -1;
+	}
+
+	// Free the chunks.
+	void release_chunks() {
+		for (size_t i = 0; i < chunks.size(); i++) {
+			row_storage->destroy(chunks[i]);
+		}
+		chunks.clear();
+		starts.clear();
+		chunk_columns.clear();
+		chunks_measured = 0;
+		last = 0;
+	}
+
+	// Find the chunk of a long row that holds the character at the specified
+	// index (the last chunk if the index is at the end of the row).
+	size_t locate(size_t index) {
+		if (last < chunks.size() &&
+			starts[last] <= index &&
+			index < starts[last + 1])
+		{
+			return last;
+		}
+		if (index >= starts.back()) {
+			last = chunks.size() - 1;
+		} else {
+			last = std::upper_bound(
+				starts.begin(),
+				starts.end(),
+				index
+			) - starts.begin() - 1;
+		}
+		return last;
+	}
+
+	// Update the offsets of the chunks of a long row from the specified chunk
+	// on, after that chunk has been edited (or chunks have been added or
+	// removed there).
+	void restart(size_t k) {
+		starts.resize(chunks.size() + 1);
+		chunk_columns.resize(chunks.size() + 1);
+		starts[0] = 0;
+		chunk_columns[0] = 0;
+		for (size_t i = k; i < chunks.size(); i++) {
+			starts[i + 1] = starts[i] + chunks[i]->size();
+		}
+		chunks_measured = std::max<size_t>(
+			std::min(chunks_measured, k + 1),
+			1
+		);
+	}
+
+	// Add text to a long row as new chunks, before the specified chunk. The
+	// chunks are split before whitespace where possible, so that fewer tokens
+	// are split between two chunks.
+	void add_chunks(size_t k, const char* text, size_t length) {
+		size_t count;
+		for (size_t i = 0; i < length; i += count) {
+			count = chunk_length(text + i, length - i);
+			chunks.insert(
+				chunks.begin() + k++,
+				row_storage->create<row>(text + i, count)
+			);
+		}
+	}
+
+	// Split a chunk that has grown too big, or remove a chunk that has become
+	// empty, and update the offsets of the chunks.
+	void rechunk(size_t k) {
+		if (chunks[k]->size() > 2 * row_chunk_size) {
+			std::string text = chunks[k]->to_string();
+			row_storage->destroy(chunks[k]);
+			chunks.erase(chunks.begin() + k);
+			add_chunks(k, text.data(), text.size());
+		} else if (chunks[k]->size() == 0 && chunks.size() > 1) {
+			row_storage->destroy(chunks[k]);
+			chunks.erase(chunks.begin() + k);
+		}
+		restart(std::min(k, chunks.size()));
+	}
+
+	// Switch between a single gap buffer and chunks as this row grows long or
+	// becomes short again.
+	void normalize() {
+		if (chunks.empty() && size() > row_long_size) {
+			add_chunks(0, data, gap_start);
+			add_chunks(chunks.size(), data + gap_end, capacity - gap_end);
+			release_flat();
+			restart(0);
+		} else if (!chunks.empty() && size() <= row_long_size / 2) {
+			std::string text = to_string();
+			release_chunks();
+			insert_flat(0, text.data(), text.size());
+		}
+	}
+
+	// Get the display column at the start of a chunk of a long row.
+	unsigned int chunk_column(size_t k) {
+		for (; chunks_measured <= k; chunks_measured++) {
+			size_t i = chunks_measured - 1;
+			chunk_columns[i + 1] = chunks[i]->end_column(chunk_columns[i]);
+		}
+		return chunk_columns[k];
+	}
+
+	// Get the index of the first tab (or the size of this row if it has
+	// none).
+	size_t first_tab() {
+		if (tab == size_t(-1) && !data) {
+			tab = 0;
+		} else if (tab == size_t(-1)) {
+			const char* found = (const char*)memchr(data, '\t', gap_start);
+			if (found) {
+				tab = found - data;
+			} else {
+				found = (const char*)memchr(
+					data + gap_end,
+					'\t',
+					capacity - gap_end
+				);
+				tab = found ? gap_start + (found - data - gap_end) : size();
+			}
+		}
+		return tab;
+	}
+
+	// Convert the display column of the character at the specified index,
+	// measured as if this row started at column zero, to the display column
+	// when this row starts at another column. Tabs align to multiples of
+	// four, so after the first tab the columns only move by a multiple of
+	// four.
+	unsigned int shift(unsigned int column, size_t index, unsigned int start) {
+		size_t t = first_tab();
+		if (index <= t) {
+			return start + column;
+		}
+		return column + 4 * ((start + t) / 4 - t / 4);
+	}
+
+	// Get the display column at the end of this row when it starts at the
+	// specified display column.
+	unsigned int end_column(unsigned int start) {
+		return shift(width(), size(), start);
+	}
+
+	// Construct a long row from its chunks, without a gap buffer.
+	explicit row(chunk_list&& parts) : chunks(std::move(parts)) {
+		restart(0);
+	}
+
 public:
 	// If this row contains an unclosed multiline comment (missing the
 	// two-character end sequence), the 'open' flag will be set.
 	bool open = false;
 
+	// The color spans of this row, ordered by their start. Characters that
+	// are not covered by a span are drawn in the default color. Long rows
+	// keep their color spans in their chunks instead.
+	span_list spans;
+
+	// The lexer state that the chunk of a long row was highlighted from (-1
+	// if it has been edited since), and the lexer state at its end.
+	int entry_state = -1;
+	int exit_state = 0;
+
 	// Conversion from std::string to row.
-	row(std::string text = "",
-		unsigned char fg = vga_gray,
-		unsigned char bg = vga_black)
-	{
-		for (unsigned int i = 0; i < text.length(); i++) {
-			push_back({text[i], fg, bg});
+	row(std::string text = "") {
+		insert(0, text.data(), text.size());
+	}
+
+	// Conversion from a character array to row. Long text is split into
+	// chunks right away.
+	row(const char* text, size_t length) {
+		if (length > row_long_size) {
+			add_chunks(0, text, length);
+			restart(0);
+		} else {
+			insert_flat(0, text, length);
 		}
 	}
 
+	// Copy constructor.
+	row(const row& other) {
+		*this = other;
+	}
+
+	// Move constructor.
+	row(row&& other) {
+		*this = std::move(other);
+	}
+
+	// Destructor.
+	~row() {
+		release_flat();
+		release_chunks();
+	}
+
+	// Copy assignment. The copy is compacted, with the gap at the end.
+	row& operator=(const row& other) {
+		if (this != &other) {
+			release_chunks();
+			gap_start = 0;
+			gap_end = capacity;
+			measured = 0;
+			tab = -1;
+			full_width = -1;
+			if (other.chunks.empty()) {
+				reserve_gap(other.size());
+				memcpy(data, other.data, other.gap_start);
+				memcpy(
+					data + other.gap_start,
+					other.data + other.gap_end,
+					(other.capacity - other.gap_end)
+				);
+				gap_start = other.size();
+				spans = other.spans;
+			} else {
+				other.segments([this](const char* text, size_t length) {
+					insert(size(), text, length);
+				});
+				spans.clear();
+			}
+			open = other.open;
+			entry_state = -1;
+			exit_state = other.exit_state;
+		}
+		return *this;
+	}
+
+	// Move assignment.
+	row& operator=(row&& other) {
+		if (this != &other) {
+			release_flat();
+			release_chunks();
+			data = other.data;
+			capacity = other.capacity;
+			gap_start = other.gap_start;
+			gap_end = other.gap_end;
+			columns = std::move(other.columns);
+			measured = other.measured;
+			tab = other.tab;
+			full_width = other.full_width;
+			chunks = std::move(other.chunks);
+			starts = std::move(other.starts);
+			chunk_columns = std::move(other.chunk_columns);
+			chunks_measured = other.chunks_measured;
+			open = other.open;
+			spans = std::move(other.spans);
+			entry_state = other.entry_state;
+			exit_state = other.exit_state;
+			other.data = NULL;
+			other.capacity = 0;
+			other.gap_start = 0;
+			other.gap_end = 0;
+			other.measured = 0;
+			other.tab = -1;
+			other.full_width = -1;
+			other.chunks.clear();
+			other.starts.clear();
+			other.chunk_columns.clear();
+			other.chunks_measured = 0;
+			other.last = 0;
+		}
+		return *this;
+	}
+
+	// Get the amount of characters in this row.
+	size_t size() const {
+		if (!chunks.empty()) {
+			return starts.back();
+		}
+		return capacity - (gap_end - gap_start);
+	}
+
+	// Access a character of this row. No bounds checking is done in this
+	// function.
+	char& operator[](size_t index) {
+		if (!chunks.empty()) {
+			size_t k = locate(index);
+			return (*chunks[k])[index - starts[k]];
+		}
+		return data[index < gap_start ? index : index + gap_end - gap_start];
+	}
+
+	// Check if this row is a long row, which is stored in chunks.
+	bool chunked() const {
+		return !chunks.empty();
+	}
+
+	// Get the amount of chunks of this row (rows that are not long are a
+	// single chunk), a chunk, the offset of its first character, and the
+	// chunk that holds the character at the specified index.
+	size_t chunk_count() const {
+		return chunks.empty() ? 1 : chunks.size();
+	}
+	row& chunk(size_t k) {
+		return chunks.empty() ? *this : *chunks[k];
+	}
+	size_t chunk_start(size_t k) const {
+		return chunks.empty() ? 0 : starts[k];
+	}
+	size_t chunk_of(size_t index) {
+		return chunks.empty() ? 0 : locate(std::min(index, size()));
+	}
+
+	// Get the characters of this row as a contiguous array, by moving the gap
+	// to the end. The chunks of a long row are each contiguous, but the row
+	// is not.
+	const char* contiguous() {
+		move_gap(size());
+		return data;
+	}
+
+	// Call a function with every contiguous range of characters of this row,
+	// in order, as f(text, length).
+	template <class F>
+	void segments(F f) const {
+		if (!chunks.empty()) {
+			for (size_t i = 0; i < chunks.size(); i++) {
+				chunks[i]->segments(f);
+			}
+			return;
+		}
+		f(data, gap_start);
+		f(data + gap_end, capacity - gap_end);
+	}
+
 	// Conversion from row to std::string.
-	std::string to_string() {
+	std::string to_string() const {
 		std::string str;
-		for (int i = 0; i < size(); i++) {
-			str += (*this)[i].ascii;
-		}
+		str.reserve(size());
+		segments([&str](const char* text, size_t length) {
+			str.append(text, length);
+		});
 		return str;
 	}
 
+	// Get a copy of a range of the characters of this row.
+	std::string substr(size_t index, size_t count) {
+		std::string str;
+		copy(str, index, count);
+		return str;
+	}
+
+	// Copy a range of the characters of this row into a string, in place of
+	// its contents. The string keeps its storage, so it can be reused.
+	void copy(std::string& str, size_t index, size_t count) {
+		index = std::min(index, size());
+		count = std::min(count, size() - index);
+		str.clear();
+		str.reserve(count);
+		for (size_t k = chunk_of(index); count > 0; k++) {
+			row& c = chunk(k);
+			size_t offset = index - chunk_start(k);
+			size_t length = std::min(count, c.size() - offset);
+			if (offset < c.gap_start) {
+				size_t before = std::min(length, c.gap_start - offset);
+				str.append(c.data + offset, before);
+				str.append(c.data + c.gap_end, length - before);
+			} else {
+				str.append(c.data + c.gap_end + offset - c.gap_start, length);
+			}
+			index += length;
+			count -= length;
+		}
+	}
+
+	// Write the characters of this row to an output (anything with a
+	// write(data, length) member) without copying them.
+	template <class T>
+	void write(T& out) {
+		segments([&out](const char* text, size_t length) {
+			out.write(text, length);
+		});
+	}
+
+	// Get the display column at which the character at the specified index
+	// is shown (or the display width of this row, at its end).
+	unsigned int display_x(size_t index) {
+		index = std::min(index, size());
+		if (!chunks.empty()) {
+			// Measure within the chunk, and move the column by where the
+			// chunk starts.
+			size_t k = locate(index);
+			size_t offset = index - starts[k];
+			unsigned int start = chunk_column(k);
+			row& c = *chunks[k];
+			return c.shift(c.display_x(offset), offset, start);
+		}
+		// Up to its first tab, this row is as wide as it is long.
+		if (index <= first_tab()) {
+			return index;
+		}
+		size_t block = index / row_column_block;
+		measure(block);
+		return advance(
+			block ? columns[block - 1] : 0,
+			block * row_column_block,
+			index
+		);
+	}
+
+	// Get the index of the character that is shown at the specified display
+	// column (or the size of this row, if it is not that wide).
+	size_t character_x(unsigned int display_x) {
+		if (!chunks.empty()) {
+			// Find the last chunk that starts at or before the column. The
+			// chunks are only measured up to the column.
+			while (chunks_measured <= chunks.size() &&
+				   chunk_columns[chunks_measured - 1] <= display_x)
+			{
+				chunk_column(chunks_measured);
+			}
+			size_t k = std::upper_bound(
+				chunk_columns.begin(),
+				chunk_columns.begin() + std::min(
+					chunks_measured,
+					chunks.size()
+				),
+				display_x
+			) - chunk_columns.begin() - 1;
+
+			// Find the character within the chunk. Up to its first tab, the
+			// chunk is as wide as it is long.
+			row& c = *chunks[k];
+			unsigned int start = chunk_columns[k];
+			size_t t = c.first_tab();
+			size_t offset;
+			if (display_x < start + t) {
+				offset = display_x - start;
+			} else if (t == c.size()) {
+				offset = c.size();
+			} else if (display_x < (start + t) / 4 * 4 + 4) {
+				offset = t;
+			} else {
+				offset = c.character_x(
+					display_x - 4 * ((start + t) / 4 - t / 4)
+				);
+			}
+			return starts[k] + offset;
+		}
+
+		// Find the last block that starts at or before the column.
+		measure(size() / row_column_block);
+		size_t block = std::upper_bound(
+			columns.begin(),
+			columns.begin() + measured,
+			display_x
+		) - columns.begin();
+
+		// Find the character within the block.
+		unsigned int column = block ? columns[block - 1] : 0;
+		for (size_t i = block * row_column_block; i < size(); i++) {
+			column = advance(column, i, i + 1);
+			if (column > display_x) {
+				return i;
+			}
+		}
+		return size();
+	}
+
+	// Get the display width of this row.
+	unsigned int width() {
+		if (!chunks.empty()) {
+			return chunk_column(chunks.size());
+		}
+		if (full_width == (unsigned int)-1) {
+			full_width = display_x(size());
+		}
+		return full_width;
+	}
+
 	// Append a row to the end of this row.
-	void append(row row) {
-		for (unsigned int i = 0; i < row.size(); i++) {
-			push_back(row[i]);
+	void append(const row& other) {
+		other.segments([this](const char* text, size_t length) {
+			insert(size(), text, length);
+		});
+	}
+
+	// Insert a character array into this row at the specified position.
+	void insert(size_t index, const char* element, size_t length) {
+		if (chunks.empty()) {
+			insert_flat(index, element, length);
+			normalize();
+			return;
 		}
+		size_t k = locate(index);
+		chunks[k]->insert_flat(index - starts[k], element, length);
+		rechunk(k);
 	}
 
 	// Insert a string into this row at the specified position.
-	void insert_str(unsigned int index,
-					std::string element,
-					unsigned char foreground = vga_gray,
-					unsigned char background = vga_black)
-	{
-		for (unsigned int i = 0; i < element.size(); i++) {
-			// Generate a glyph.
-			glyph glyph = {
-				element[element.size() - i - 1],
-				foreground,
-				background
-			};
+	void insert_str(unsigned int index, std::string element) {
+		insert(index, element.data(), element.size());
+	}
+
+	// Erase characters from this row, starting at the specified position.
+	void erase(size_t index, size_t count = 1) {
+		if (chunks.empty()) {
+			erase_flat(index, count);
+			return;
+		}
 
-			// Insert the glyph.
-			insert(begin() + index, glyph);
+		// Erase the characters from every chunk they are in.
+		size_t first = locate(index);
+		size_t k = first;
+		size_t offset = index - starts[k];
+		while (count > 0 && k < chunks.size()) {
+			size_t length = std::min(count, chunks[k]->size() - offset);
+			chunks[k]->erase_flat(offset, length);
+			count -= length;
+			offset = 0;
+			k++;
 		}
+
+		// Remove the chunks that have become empty.
+		for (size_t i = k; i-- > first && chunks.size() > 1;) {
+			if (chunks[i]->size() == 0) {
+				row_storage->destroy(chunks[i]);
+				chunks.erase(chunks.begin() + i);
+			}
+		}
+		restart(std::min(first, chunks.size()));
+		normalize();
 	}
 
 	// Split this row at a certain index, and return the right side. Discard the
 	// right side from this row.
 	row split(unsigned int index) {
-		row right;
-		for (unsigned int i = index; i < size(); i++) {
-			right.push_back((*this)[i]);
+		if (chunks.empty()) {
+			return split_flat(index);
 		}
-		erase(begin() + index, end());
+
+		// Split the chunk at the index, and move its right side and the
+		// chunks after it to the right side.
+		size_t k = locate(index);
+		chunk_list parts;
+		parts.push_back(
+			row_storage->create<row>(chunks[k]->split_flat(index - starts[k]))
+		);
+		parts.insert(parts.end(), chunks.begin() + k + 1, chunks.end());
+		chunks.resize(k + 1);
+		row right(std::move(parts));
+		rechunk(k);
+		right.rechunk(0);
+		right.open = open;
+		normalize();
+		right.normalize();
 		return right;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,142 @@
+// The size of the buffer that text is collected in while saving.
+const size_t save_buffer_size = 1 << 22;
+
+// A buffered file writer. Text is collected in a large buffer that is reused
+// between saves and written to the file in big chunks, and text that is
+// bigger than the buffer is written directly.
+struct file_writer {
+	// The write buffer, and the amount of it that is in use.
+	std::vector<char> buffer;
+	size_t used = 0;
+
+	// The file that is being written.
+	FILE* file = NULL;
+
+	// The amount of bytes that have been written to the file.
+	size_t written = 0;
+
+	// If a write failed, this flag will be set.
+	bool failed = false;
+
+	// Write a character array to the file.
+	void write(const char* data, size_t length) {
+		if (used + length > buffer.size()) {
+			flush();
+		}
+		if (length >= buffer.size()) {
+			write_through(data, length);
+		} else {
+			memcpy(buffer.data() + used, data, length);
+			used += length;
+		}
+	}
+
+	// Write the contents of the write buffer to the file.
+	void flush() {
+		write_through(buffer.data(), used);
+		used = 0;
+	}
+
+	// Write a character array to the file without buffering it.
+	void write_through(const char* data, size_t length) {
+		if (!failed && length > 0) {
+			if (fwrite(data, 1, length, file) != length) {
+				failed = true;
+			}
+			written += length;
+		}
+	}
+
+	// Save a document to a file. The document is written to a temporary file
+	// in the same directory, which is flushed to disk and then renamed over
+	// the file, so the file is never left half written. If the file is a
+	// symbolic link, the file it links to is replaced instead. Returns false
+	// if the document could not be saved.
+	bool save(document& doc, std::string filename) {
+		buffer.resize(save_buffer_size);
+		used = 0;
+		written = 0;
+		failed = false;
+
+		#ifndef _WIN32
+		// Resolve symbolic links, so that the link itself is kept.
+		char* resolved = realpath(filename.c_str(), NULL);
+		if (resolved) {
+			filename = resolved;
+			free(resolved);
+		}
+		#endif
+
+		// Create the temporary file.
+		std::string temporary = filename + ".XXXXXX";
+		#ifndef _WIN32
+		int fd = mkstemp(&temporary[0]);
+		if (fd < 0) {
+			return false;
+		}
+		// Keep the permissions of the file.
+		struct stat info;
+		if (stat(filename.c_str(), &info) == 0) {
+			fchmod(fd, info.st_mode & 07777);
+		}
+		file = fdopen(fd, "wb");
+		if (!file) {
+			close(fd);
+			unlink(temporary.c_str());
+			return false;
+		}
+		#else
+		temporary = filename + ".boss~";
+		file = fopen(temporary.c_str(), "wb");
+		if (!file) {
+			return false;
+		}
+		#endif
+		setvbuf(file, NULL, _IONBF, 0);
+
+		// Stream the document to the temporary file.
+		doc.write(*this);
+		flush();
+
+		// Flush the temporary file to disk.
+		if (fflush(file) != 0) {
+			failed = true;
+		}
+		#ifndef _WIN32
+		if (fsync(fileno(file)) != 0) {
+			failed = true;
+		}
+		#endif
+		if (fclose(file) != 0) {
+			failed = true;
+		}
+		file = NULL;
+
+		// Replace the file with the temporary file.
+		if (!failed) {
+			#ifdef _WIN32
+			remove(filename.c_str());
+			#endif
+			if (rename(temporary.c_str(), filename.c_str()) != 0) {
+				failed = true;
+			}
+		}
+		#ifndef _WIN32
+		// Flush the directory to disk, so that the rename is durable.
+		if (!failed) {
+			size_t slash = filename.rfind('/');
+			std::string directory = slash == std::string::npos ? "." :
+				slash == 0 ? "/" : filename.substr(0, slash);
+			int dir = open(directory.c_str(), O_RDONLY);
+			if (dir >= 0) {
+				fsync(dir);
+				close(dir);
+			}
+		}
+		#endif
+		if (failed) {
+			remove(temporary.c_str());
+		}
+		return !failed;
+	}
+};
\ No newline at end of file
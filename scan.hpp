@@ -0,0 +1,208 @@
+// Count the trailing zero bits of a non-zero bit mask.
+inline int trailing_zeros(unsigned int mask) {
+	#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+	#else
+	return __builtin_ctz(mask);
+	#endif
+}
+
+// Find the index of the highest set bit of a non-zero bit mask.
+inline int highest_bit(unsigned int mask) {
+	#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return index;
+	#else
+	return 31 - __builtin_clz(mask);
+	#endif
+}
+
+// Count the set bits of a bit mask.
+inline int population_count(unsigned int mask) {
+	#ifdef _MSC_VER
+	return __popcnt(mask);
+	#else
+	return __builtin_popcount(mask);
+	#endif
+}
+
+// Scan a range of text for newlines, and append the offset of the character
+// following every newline to a vector. The text is compared 32 (AVX2) or 16
+// (SSE2) characters at a time, with a scalar loop for the remainder.
+void scan_newlines(const char* data,
+				   size_t begin,
+				   size_t end,
+				   std::vector<size_t>& out)
+{
+	size_t i = begin;
+
+	#if defined(__AVX2__)
+	const __m256i newline_32 = _mm256_set1_epi8('\n');
+	for (; i + 32 <= end; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+		unsigned int mask = _mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(chunk, newline_32)
+		);
+		while (mask) {
+			out.push_back(i + trailing_zeros(mask) + 1);
+			mask &= mask - 1;
+		}
+	}
+	#endif
+
+	#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i newline_16 = _mm_set1_epi8('\n');
+	for (; i + 16 <= end; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+		unsigned int mask = _mm_movemask_epi8(
+			_mm_cmpeq_epi8(chunk, newline_16)
+		);
+		while (mask) {
+			out.push_back(i + trailing_zeros(mask) + 1);
+			mask &= mask - 1;
+		}
+	}
+	#endif
+
+	for (; i < end; i++) {
+		if (data[i] == '\n') {
+			out.push_back(i + 1);
+		}
+	}
+}
+
+// Count the newlines in a range of text. The offset of the character
+// following the last newline is stored in last (which is left unchanged if
+// there are no newlines).
+size_t count_newlines(const char* data,
+					  size_t begin,
+					  size_t end,
+					  size_t& last)
+{
+	size_t count = 0;
+	size_t i = begin;
+
+	#if defined(__AVX2__)
+	const __m256i newline_32 = _mm256_set1_epi8('\n');
+	for (; i + 32 <= end; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+		unsigned int mask = _mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(chunk, newline_32)
+		);
+		if (mask) {
+			count += population_count(mask);
+			last = i + highest_bit(mask) + 1;
+		}
+	}
+	#endif
+
+	#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i newline_16 = _mm_set1_epi8('\n');
+	for (; i + 16 <= end; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+		unsigned int mask = _mm_movemask_epi8(
+			_mm_cmpeq_epi8(chunk, newline_16)
+		);
+		if (mask) {
+			count += population_count(mask);
+			last = i + highest_bit(mask) + 1;
+		}
+	}
+	#endif
+
+	for (; i < end; i++) {
+		if (data[i] == '\n') {
+			count++;
+			last = i + 1;
+		}
+	}
+	return count;
+}
+
+// Find every occurrence of a needle that starts in a range of text, and call
+// a function with the offset of each. An occurrence may extend up to limit.
+// Occurrences do not overlap: the search moves on past the end of every
+// occurrence, like replacing does. Returns the offset that the search carries
+// on from in the next range (the end of the range, or of the last occurrence
+// if that is further). Candidates are found by comparing the first and the
+// last character of the needle at 32 (AVX2) or 16 (SSE2) positions at a
+// time, and only candidates that match both are compared in full.
+template <class F>
+size_t find_all(const char* data,
+				size_t begin,
+				size_t end,
+				size_t limit,
+				const char* needle,
+				size_t length,
+				F found)
+{
+	if (length == 0 || limit < length) {
+		return std::max(begin, end);
+	}
+	// Occurrences must start before stop to fit before limit.
+	size_t stop = std::min(end, limit - length + 1);
+	size_t i = begin;
+
+	// Candidates must start at or after next, the end of the last occurrence.
+	size_t next = begin;
+
+	#if defined(__AVX2__)
+	const __m256i first_32 = _mm256_set1_epi8(needle[0]);
+	const __m256i last_32 = _mm256_set1_epi8(needle[length - 1]);
+	for (; i + 32 <= stop; i += 32) {
+		__m256i head = _mm256_loadu_si256((const __m256i*)(data + i));
+		__m256i tail = _mm256_loadu_si256(
+			(const __m256i*)(data + i + length - 1)
+		);
+		unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpeq_epi8(head, first_32),
+			_mm256_cmpeq_epi8(tail, last_32)
+		));
+		while (mask) {
+			size_t j = i + trailing_zeros(mask);
+			if (j >= next &&
+				(length <= 2 || !memcmp(data + j + 1, needle + 1, length - 2)))
+			{
+				found(j);
+				next = j + length;
+			}
+			mask &= mask - 1;
+		}
+	}
+	#endif
+
+	#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i first_16 = _mm_set1_epi8(needle[0]);
+	const __m128i last_16 = _mm_set1_epi8(needle[length - 1]);
+	for (; i + 16 <= stop; i += 16) {
+		__m128i head = _mm_loadu_si128((const __m128i*)(data + i));
+		__m128i tail = _mm_loadu_si128((const __m128i*)(data + i + length - 1));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpeq_epi8(head, first_16),
+			_mm_cmpeq_epi8(tail, last_16)
+		));
+		while (mask) {
+			size_t j = i + trailing_zeros(mask);
+			if (j >= next &&
+				(length <= 2 || !memcmp(data + j + 1, needle + 1, length - 2)))
+			{
+				found(j);
+				next = j + length;
+			}
+			mask &= mask - 1;
+		}
+	}
+	#endif
+
+	for (i = std::max(i, next); i < stop; i++) {
+		if (data[i] == needle[0] && !memcmp(data + i, needle, length)) {
+			found(i);
+			i += length - 1;
+			next = i + 1;
+		}
+	}
+	return std::max(next, end);
+}
\ No newline at end of file
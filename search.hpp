@@ -0,0 +1,396 @@
+// The amount of text that the search worker scans before it reports the
+// matches it has found.
+const size_t search_block_size = 1 << 20;
+
+// The maximum amount of matches whose positions are kept. Matches beyond
+// this are only counted.
+const size_t search_match_limit = 1 << 20;
+
+// A match of a search.
+struct search_match {
+	// The line and column of the match.
+	size_t line;
+	size_t column;
+
+	// The piece the match is in, and the text of the match.
+	size_t piece;
+	const char* text;
+};
+
+// The position that the search worker has scanned up to.
+struct search_position {
+	// The piece, and the offset into the piece.
+	size_t piece;
+	size_t offset;
+
+	// Lines are only counted up to the last match, so that text without
+	// matches is scanned once. The line number at the counted offset, and
+	// the offset of the start of that line.
+	size_t counted;
+	size_t line;
+	size_t line_start;
+};
+
+// An incremental search. The search runs over a snapshot of the document on
+// a worker thread, which reports its matches in batches. When the query grows
+// the matches found so far are narrowed down instead of searched again, and
+// the worker carries on from where it was. When the document is edited the
+// matches above the first edited line are kept, and the worker carries on
+// from that line.
+class searcher {
+private:
+	// The snapshot of the document.
+	document_snapshot source;
+
+	// The query the worker searches for, and the compiled query if it is a
+	// regular expression. The worker has its own copy of the expression,
+	// because matching builds its automata.
+	std::string needle;
+	bool expression = false;
+	regex pattern;
+
+	// The position the worker has scanned up to, the matches it has found
+	// that have not been collected, and the amount of them (including the
+	// ones that were not kept).
+	search_position scanned;
+	std::vector<search_match> found;
+	size_t found_count = 0;
+
+	// The amount of matches that were kept from an earlier snapshot. Their
+	// text is not in this snapshot, so they cannot be narrowed down.
+	size_t carried = 0;
+
+	// The worker, and the synchronization of its results.
+	std::thread worker;
+	std::atomic<bool> stop;
+	std::mutex mutex;
+
+	// Scan the snapshot for the query on the worker thread, and report the
+	// matches once per block.
+	void work(size_t kept) {
+		search_position at = scanned;
+		std::vector<search_match> batch;
+		while (at.piece < source.pieces.size() && !stop) {
+			snapshot_piece& piece = source.pieces[at.piece];
+			size_t end = std::min(at.offset + search_block_size, piece.end);
+			size_t batch_count = 0;
+
+			// Add a match to the batch.
+			auto add = [&](size_t j) {
+				batch_count++;
+				if (kept < search_match_limit) {
+					batch.push_back({
+						at.line,
+						j - at.line_start,
+						at.piece,
+						piece.data + j
+					});
+					kept++;
+				}
+			};
+
+			if (expression) {
+				// Regular expressions are matched a line at a time, so the
+				// block is extended to the end of its last line.
+				const char* newline = (const char*)memchr(
+					piece.data + end,
+					'\n',
+					piece.end - end
+				);
+				end = newline ? newline - piece.data + 1 : piece.end;
+				while (at.offset < end) {
+					const char* text = piece.data + at.offset;
+					newline = (const char*)memchr(text, '\n', end - at.offset);
+					size_t length = newline ? newline - text : end - at.offset;
+					at.line_start = at.offset;
+					pattern.find_all(text, length, [&](size_t s, size_t) {
+						add(at.offset + s);
+					});
+					at.offset += length + (newline ? 1 : 0);
+					at.line += newline ? 1 : 0;
+				}
+				at.counted = end;
+				at.line_start = end;
+			} else {
+				// Find the matches in the block, and count the lines up to
+				// each of them. A match may run past the end of the block,
+				// and the next block starts after it.
+				at.offset = find_all(
+					piece.data,
+					at.offset,
+					end,
+					piece.end,
+					needle.data(),
+					needle.size(),
+					[&](size_t j) {
+						at.line += count_newlines(
+							piece.data,
+							at.counted,
+							j,
+							at.line_start
+						);
+						at.counted = j;
+						add(j);
+					}
+				);
+			}
+
+			// Move on to the next piece.
+			if (at.offset == piece.end) {
+				at.piece++;
+				if (at.piece < source.pieces.size()) {
+					at.offset = source.pieces[at.piece].begin;
+					at.counted = at.offset;
+					at.line = source.pieces[at.piece].line;
+					at.line_start = at.offset;
+				}
+			}
+
+			// Report the matches of the block.
+			std::lock_guard<std::mutex> lock(mutex);
+			found.insert(found.end(), batch.begin(), batch.end());
+			found_count += batch_count;
+			scanned = at;
+			batch.clear();
+		}
+	}
+
+	// Stop and join the worker.
+	void halt() {
+		if (worker.joinable()) {
+			stop = true;
+			worker.join();
+			stop = false;
+		}
+		collect();
+	}
+
+	// Check if a query can overlap itself (if it starts with its own end).
+	// The matches of such a query are not all found when the scan skips
+	// over the matches of a shorter query.
+	static bool overlaps_itself(const std::string& text) {
+		for (size_t k = 1; k < text.size(); k++) {
+			if (!text.compare(0, k, text, text.size() - k, k)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Move the scan back to the start of the snapshot.
+	void rewind() {
+		scanned.piece = 0;
+		scanned.offset = source.pieces.empty() ? 0 : source.pieces[0].begin;
+		scanned.counted = scanned.offset;
+		scanned.line = source.pieces.empty() ? 0 : source.pieces[0].line;
+		scanned.line_start = scanned.offset;
+		matches.clear();
+		count = 0;
+		carried = 0;
+	}
+
+public:
+	// The query, and the matches that have been collected, in document order.
+	std::string query;
+	std::vector<search_match> matches;
+
+	// The amount of matches that have been collected (including the ones
+	// that were not kept).
+	size_t count = 0;
+
+	// Default constructor.
+	searcher(): stop(false) {
+		rewind();
+	}
+
+	// Destructor.
+	~searcher() {
+		halt();
+	}
+
+	// Disallow copying.
+	searcher(const searcher&) = delete;
+	searcher& operator=(const searcher&) = delete;
+
+	// Take a snapshot of a document to search. The search must be started
+	// again afterwards.
+	void snapshot(document& doc) {
+		halt();
+		source.take(doc);
+		query.clear();
+		rewind();
+	}
+
+	// Take a snapshot of a document that has been edited from a line on. The
+	// matches above the line are kept (as far as the document was searched),
+	// and the search carries on from the line once it is started again with
+	// the same query.
+	void resume(document& doc, size_t line) {
+		halt();
+		if (query.empty()) {
+			snapshot(doc);
+			return;
+		}
+
+		// Keep the matches above the line. Lines are only counted up to the
+		// last match, and the matches past the limit are not kept, so the
+		// line may have to move up.
+		if (scanned.piece < source.pieces.size()) {
+			line = std::min(line, scanned.line);
+		}
+		if (count > matches.size() && !matches.empty()) {
+			line = std::min(line, matches.back().line);
+		}
+		search_match key = {line, 0, 0, NULL};
+		matches.erase(
+			std::lower_bound(
+				matches.begin(),
+				matches.end(),
+				key,
+				[](const search_match& a, const search_match& b) {
+					return a.line < b.line;
+				}
+			),
+			matches.end()
+		);
+		count = matches.size();
+		carried = count;
+
+		// Take the snapshot, and move the scan to the start of the line.
+		source.take(doc);
+		if (source.pieces.empty()) {
+			rewind();
+			return;
+		}
+		size_t p = std::upper_bound(
+			source.pieces.begin(),
+			source.pieces.end(),
+			line,
+			[](size_t line, const snapshot_piece& piece) {
+				return line < piece.line;
+			}
+		) - source.pieces.begin() - 1;
+		snapshot_piece& piece = source.pieces[p];
+		size_t offset = piece.begin;
+		size_t at = piece.line;
+		while (at < line) {
+			const char* newline = (const char*)memchr(
+				piece.data + offset,
+				'\n',
+				piece.end - offset
+			);
+			if (!newline) {
+				break;
+			}
+			offset = newline - piece.data + 1;
+			at++;
+		}
+		scanned.piece = p;
+		scanned.offset = offset;
+		scanned.counted = offset;
+		scanned.line = at;
+		scanned.line_start = offset;
+	}
+
+	// Discard the snapshot.
+	void cancel() {
+		halt();
+		source.clear();
+		query.clear();
+		rewind();
+	}
+
+	// Start searching the snapshot for a query, which is a regular expression
+	// if the regular flag is set. If the query is the previous query, the scan
+	// continues where it was. If a plain query extends the previous query, the
+	// matches found so far are narrowed down and the scan continues where it
+	// was. This needs every occurrence of the previous query to have been
+	// found, so the previous query must not overlap itself. An invalid regular
+	// expression matches nothing.
+	void start(const std::string& text, bool regular = false) {
+		halt();
+		bool same = !query.empty() && text == query && regular == expression;
+		bool extends = !same && !regular && !expression && !query.empty() &&
+					   text.compare(0, query.size(), query) == 0 &&
+					   count == matches.size() && carried == 0 &&
+					   !overlaps_itself(query);
+		if (extends) {
+			// Keep the matches that are followed by the rest of the query,
+			// and that do not overlap the match kept before them. Lines end
+			// with a newline (which the query cannot contain) or with the
+			// end of a piece.
+			size_t kept = 0;
+			for (size_t i = 0; i < matches.size(); i++) {
+				search_match& match = matches[i];
+				snapshot_piece& piece = source.pieces[match.piece];
+				size_t offset = match.text - piece.data;
+				bool overlaps = kept > 0 &&
+								matches[kept - 1].piece == match.piece &&
+								matches[kept - 1].text + text.size() > match.text;
+				if (!overlaps &&
+					offset + text.size() <= piece.end &&
+					!memcmp(match.text, text.data(), text.size()))
+				{
+					matches[kept++] = match;
+				}
+			}
+			matches.resize(kept);
+			count = kept;
+
+			// The scan carries on after the last match.
+			if (kept > 0 && matches[kept - 1].piece == scanned.piece) {
+				size_t offset = matches[kept - 1].text -
+								source.pieces[scanned.piece].data;
+				scanned.offset = std::max(scanned.offset, offset + text.size());
+			}
+		} else if (!same) {
+			rewind();
+		}
+		query = text;
+		needle = text;
+		expression = regular;
+		if (regular && !pattern.compile(text)) {
+			scanned.piece = source.pieces.size();
+		}
+		if (!query.empty() && !complete()) {
+			worker = std::thread(&searcher::work, this, matches.size());
+		}
+	}
+
+	// Collect the matches that the worker has reported.
+	void collect() {
+		std::lock_guard<std::mutex> lock(mutex);
+		matches.insert(matches.end(), found.begin(), found.end());
+		count += found_count;
+		found.clear();
+		found_count = 0;
+	}
+
+	// Check if the whole snapshot has been searched.
+	bool complete() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return query.empty() || scanned.piece >= source.pieces.size();
+	}
+
+	// Get the first collected match after a position, wrapping around to the
+	// first match. Returns NULL if there are no matches.
+	search_match* next(size_t line, size_t column) {
+		if (matches.empty()) {
+			return NULL;
+		}
+		search_match key = {line, column, 0, NULL};
+		auto after = std::upper_bound(
+			matches.begin(),
+			matches.end(),
+			key,
+			[](const search_match& a, const search_match& b) {
+				return a.line < b.line ||
+					   (a.line == b.line && a.column < b.column);
+			}
+		);
+		if (after == matches.end()) {
+			after = matches.begin();
+		}
+		return &*after;
+	}
+};
\ No newline at end of file
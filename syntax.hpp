@@ -12,35 +12,133 @@ std::string highlight_mode_string[] = {
 	"cpp"
 };
 
-// Import syntax highlighting rules for C.
-namespace HI_c {
+// The lexer state that is carried from the end of a row to the next row, and
+// from the end of a chunk of a long row to the next chunk. Only an open
+// multiline comment carries over to the next row. The quotation character of
+// an unclosed string literal is stored from bit 8 up.
+enum lexer_state {
+	ls_open = 1,
+	ls_directive = 2,
+	ls_comment = 4,
+	ls_escaped = 8
+};
+
+// The lexer, and the syntax highlighting rules of every language.
+#include "lexer.hpp"
 #include "syntax_c.hpp"
+#include "syntax_cpp.hpp"
+
+// Highlight a row (or a chunk of a long row) with the syntax highlighting
+// rules of a language, starting from a lexer state. The state that the row
+// was highlighted from and the state at its end are stored in the row.
+template <class L>
+void lex_chunk(row& text, int state, bool continued) {
+	const vga_color* colors = L::colors();
+	text.spans.clear();
+	lexer<L> lexer(text.contiguous(), text.size(), state, continued);
+	token token;
+	while (lexer.next(token)) {
+		// Color the segment of the row represented by the token. Adjacent
+		// segments of the same color share a span.
+		unsigned char color = colors[token.type];
+		if (!text.spans.empty() && text.spans.back().color == color) {
+			text.spans.back().length += token.length;
+		} else {
+			text.spans.push_back({
+				(unsigned int)token.offset,
+				(unsigned int)token.length,
+				color
+			});
+		}
+	}
+	text.entry_state = state;
+	text.exit_state = lexer.state();
+}
+
+// Find the lexer state at the end of a row (or a chunk of a long row) with the
+// syntax highlighting rules of a language, starting from a lexer state.
+template <class L>
+int lex_state(const char* text, size_t length, int state, bool continued) {
+	lexer<L> lexer(text, length, state, continued);
+	token token;
+	while (lexer.next(token)) {
+		continue;
+	}
+	return lexer.state();
 }
 
-// All file extensions that use the hm_c rules.
-std::string ext_hm_c[] = {
-	".c"
+// A function that highlights a row (or a chunk of a long row), starting from
+// a lexer state.
+typedef void (*chunk_lexer)(row& text, int state, bool continued);
+
+// A function that finds the lexer state at the end of a row (or a chunk of a
+// long row), starting from a lexer state.
+typedef int (*state_scanner)(const char* text,
+							 size_t length,
+							 int state,
+							 bool continued);
+
+// A syntax highlighting engine: the lexer of a language, specialized for its
+// rules, and the file extensions that use it.
+struct syntax_engine {
+	chunk_lexer lex;
+	state_scanner scan;
+	std::vector<std::string> extensions;
 };
 
-// Import syntax highlighting rules for C++.
-namespace HI_cpp {
-#include "syntax_cpp.hpp"
-}
+// The syntax highlighting engine of every syntax highlighting mode. The
+// editor looks the engine of its mode up here, so a language is added by
+// adding its rules and a row to this table.
+const syntax_engine syntax_engines[] = {
+	// hm_null
+	{NULL, NULL, {}},
+	// hm_c
+	{lex_chunk<c_rules>, lex_state<c_rules>, {".c"}},
+	// hm_cpp
+	{
+		lex_chunk<cpp_rules>,
+		lex_state<cpp_rules>,
+		{
+			".C",
+			".cc",
+			".cpp",
+			".CPP",
+			".c++",
+			".cp",
+			".cxx",
+			".H",
+			".hh",
+			".hpp",
+			".HPP",
+			".h++",
+			".hp",
+			".hxx"
+		}
+	}
+};
 
-// All file extensions that use the hm_cpp rules.
-std::string ext_hm_cpp[] = {
-	".C",
-	".cc",
-	".cpp",
-	".CPP",
-	".c++",
-	".cp",
-	".cxx",
-	".H",
-	".hh",
-	".hpp",
-	".HPP",
-	".h++",
-	".hp",
-	".hxx"
-};
\ No newline at end of file
+// Find the syntax highlighting mode of a file by comparing the end of its
+// name to the file extensions of every mode.
+highlight_mode find_highlight_mode(const std::string& filename) {
+	highlight_mode found = hm_null;
+	int modes = sizeof(syntax_engines) / sizeof(syntax_engines[0]);
+	for (int mode = 0; mode < modes; mode++) {
+		const std::vector<std::string>& extensions =
+			syntax_engines[mode].extensions;
+		for (size_t i = 0; i < extensions.size(); i++) {
+			const std::string& suffix = extensions[i];
+			if (suffix.size() > filename.size()) {
+				continue;
+			}
+			bool is_match = std::equal(
+				suffix.rbegin(),
+				suffix.rend(),
+				filename.rbegin()
+			);
+			if (is_match) {
+				found = highlight_mode(mode);
+			}
+		}
+	}
+	return found;
+}
\ No newline at end of file
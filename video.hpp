@@ -19,6 +19,10 @@ public:
 	Uint32* real_video = NULL;
 	#endif
 
+	// The rectangles of the video memory that have changed since the last
+	// push. Only these are uploaded to the video card.
+	std::vector<SDL_Rect> dirty;
+
 	// Quit.
 	void quit() {
 		// Free the video memory.
@@ -48,8 +52,38 @@ public:
 		}
 	}
 
+	// Mark a rectangle of the video memory as changed. The rectangle is
+	// clipped to the video memory, and merged with the last rectangle if it
+	// continues it downwards.
+	void touch(int x, int y, int w, int h) {
+		if (x < 0) {
+			w += x;
+			x = 0;
+		}
+		if (y < 0) {
+			h += y;
+			y = 0;
+		}
+		w = std::min(w, x_res - x);
+		h = std::min(h, y_res - y);
+		if (w <= 0 || h <= 0) {
+			return;
+		}
+		if (!dirty.empty()) {
+			SDL_Rect& above = dirty.back();
+			if (above.x == x && above.w == w && above.y + above.h == y) {
+				above.h += h;
+				return;
+			}
+		}
+		dirty.push_back({x, y, w, h});
+	}
+
 	#ifdef LAZY_MAN_NTSC
-	// Apply a completely fake NTSC filter.
+	// Apply a completely fake NTSC filter to the changed rectangles of the
+	// video memory. Every pixel bleeds half of its red into the pixel to its
+	// left, half of its green into the pixel to its right and half of its blue
+	// into the pixel below it, so the rectangles grow by those pixels.
 	void ntsc() {
 		#define NTSC_RGB(r, g, b) ((Uint32)((Uint8)(r) << 16 | \
 											(Uint8)(g) << 8 | \
@@ -63,46 +97,35 @@ public:
 		#define NTSC_MAX(x, y) ((x) > (y) ? (x) : (y))
 
 		#define NTSC_CLAMP(x) (NTSC_MIN(NTSC_MAX((x), 0), 255))
-		
-		memcpy(real_video, video, x_res * y_res * sizeof(Uint32));
 
-		for (int j = 0; j < y_res; j++)
-		for (int i = 0; i < x_res; i++) {
-			Uint32 source = video[j * x_res + i];
-			int source_r = NTSC_R(source) / 2;
-			int source_g = NTSC_G(source) / 2;
-			int source_b = NTSC_B(source) / 2;
-			if (i > 0) {
-				Uint32 dest = real_video[j * x_res + (i - 1)];
-				int dest_r = NTSC_R(dest);
-				int dest_g = NTSC_G(dest);
-				int dest_b = NTSC_B(dest);
-				real_video[j * x_res + (i - 1)] = NTSC_RGB(
-					NTSC_CLAMP(dest_r + source_r),
-					dest_g,
-					dest_b
-				);
-			}
-			if (i < x_res - 1) {
-				Uint32 dest = real_video[j * x_res + (i + 1)];
-				int dest_r = NTSC_R(dest);
-				int dest_g = NTSC_G(dest);
-				int dest_b = NTSC_B(dest);
-				real_video[j * x_res + (i + 1)] = NTSC_RGB(
-					dest_r,
-					NTSC_CLAMP(dest_g + source_g),
-					dest_b
-				);
-			}
-			if (j < y_res - 1) {
-				Uint32 dest = real_video[(j + 1) * x_res + i];
-				int dest_r = NTSC_R(dest);
-				int dest_g = NTSC_G(dest);
-				int dest_b = NTSC_B(dest);
-				real_video[(j + 1) * x_res + i] = NTSC_RGB(
-					dest_r,
-					dest_g,
-					NTSC_CLAMP(dest_b + source_b)
+		std::vector<SDL_Rect> changed;
+		changed.swap(dirty);
+		for (size_t k = 0; k < changed.size(); k++) {
+			SDL_Rect rect = changed[k];
+			touch(rect.x - 1, rect.y, rect.w + 2, rect.h + 1);
+		}
+
+		for (size_t k = 0; k < dirty.size(); k++) {
+			SDL_Rect rect = dirty[k];
+			for (int j = rect.y; j < rect.y + rect.h; j++)
+			for (int i = rect.x; i < rect.x + rect.w; i++) {
+				Uint32 source = video[j * x_res + i];
+				int r = NTSC_R(source);
+				int g = NTSC_G(source);
+				int b = NTSC_B(source);
+				if (i < x_res - 1) {
+					r += NTSC_R(video[j * x_res + (i + 1)]) / 2;
+				}
+				if (i > 0) {
+					g += NTSC_G(video[j * x_res + (i - 1)]) / 2;
+				}
+				if (j > 0) {
+					b += NTSC_B(video[(j - 1) * x_res + i]) / 2;
+				}
+				real_video[j * x_res + i] = NTSC_RGB(
+					NTSC_CLAMP(r),
+					NTSC_CLAMP(g),
+					NTSC_CLAMP(b)
 				);
 			}
 		}
@@ -176,15 +199,25 @@ public:
 		#endif
 	}
 	
-	// Video output function.
+	// Video output function. Only the changed rectangles of the video memory
+	// are uploaded; the SDL_Texture* keeps the rest.
 	void push() {
 		#ifdef LAZY_MAN_NTSC
-		// Update the SDL_Texture*.
-		SDL_UpdateTexture(sdl_texture, NULL, real_video, x_res * sizeof(Uint32));
+		Uint32* pixels = real_video;
 		#else
-		// Update the SDL_Texture*.
-		SDL_UpdateTexture(sdl_texture, NULL, video, x_res * sizeof(Uint32));
+		Uint32* pixels = video;
 		#endif
+		// Update the SDL_Texture*.
+		for (size_t i = 0; i < dirty.size(); i++) {
+			SDL_Rect& rect = dirty[i];
+			SDL_UpdateTexture(
+				sdl_texture,
+				&rect,
+				pixels + rect.y * x_res + rect.x,
+				x_res * sizeof(Uint32)
+			);
+		}
+		dirty.clear();
 		// Copy the SDL_Texture* to the SDL_Renderer*.
 		SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
 		// Update the SDL_Renderer*.